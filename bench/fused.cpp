@@ -0,0 +1,147 @@
+/* Measures how many replicates a second ResampleFused produces for batches of
+ * K walks, against Resample applying them one at a time. Build with `make
+ * bench` and run as
+ *
+ *     bin/bench-fused [taxa] [length] [replicates] [max K] [bias]
+ *
+ * For each K up to max K, the walks are applied one at a time with Resample and
+ * then K at a time with ResampleFused, both cycling through the same K output
+ * matrices as the pipeline cycles through its buffers. Once the input is
+ * larger than the last level cache, Resample reads from memory whatever part of
+ * it a walk covers for every replicate, while ResampleFused reads it once per
+ * K. How much of each row the walks cover is printed too, since that bounds
+ * what fusing can save. Memory use is about (max K + 1) times the input.
+ * Outputs are checked against Resample first, exits with 1 if they differ.
+ */
+
+#include "../src/sequence.hpp"
+#include "../src/walk.hpp"
+#include "../src/resample.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+using std::memcmp;
+#include <iostream>
+using std::cout; using std::cerr; using std::endl;
+#include <iomanip>
+using std::setw; using std::left; using std::fixed; using std::setprecision;
+#include <string>
+using std::string; using std::stoul; using std::stod;
+#include <vector>
+using std::vector;
+#include <random>
+using std::mt19937_64; using std::uniform_int_distribution;
+
+typedef std::chrono::steady_clock Clock;
+
+static double SecondsSince(Clock::time_point start){
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+//The fraction of the input's columns a walk reads from
+static double Coverage(const RandomWalk& walk, size_t input_length){
+    size_t low = input_length, high = 0;
+    for(const WalkSegment& segment : walk){
+        size_t begin = segment.direction == Direction::Right ? segment.original_pos
+                       : segment.original_pos + 1 - segment.length;
+        low = std::min(low, begin);
+        high = std::max(high, begin + segment.length);
+    }
+    return high > low ? double(high - low) / input_length : 0;
+}
+
+static bool SameMatrix(const CharMatrix& first, const CharMatrix& second){
+    if(first.height() != second.height() || first.length() != second.length()){
+        return false;
+    }
+    for(size_t row = 0; row < first.height(); row++){
+        if(memcmp(first.row(row), second.row(row), first.length()) != 0){
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char* argv[]){
+    size_t height = argc > 1 ? stoul(argv[1]) : 256;
+    size_t length = argc > 2 ? stoul(argv[2]) : 262144;
+    size_t replicates = argc > 3 ? stoul(argv[3]) : 64;
+    size_t max_k = argc > 4 ? stoul(argv[4]) : 16;
+    double bias = argc > 5 ? stod(argv[5]) : 0.01;
+
+    mt19937_64 rng(42);
+    const char bases[] = "ACGT-";
+    uniform_int_distribution<int> base_dist(0, 4);
+    CharMatrix input(height, length);
+    for(size_t row = 0; row < height; row++){
+        for(size_t col = 0; col < length; col++){
+            input.set(row, col, bases[base_dist(rng)]);
+        }
+    }
+    vector<RandomWalk> walks;
+    for(size_t i = 0; i < replicates; i++){
+        mt19937_64 walk_rng = ReplicateRNG(42, i + 1);
+        walks.push_back(GenerateRandomWalk(length, length, bias, walk_rng));
+    }
+
+    //Check a fused batch against Resample before timing anything
+    {
+        size_t batch = replicates < 8 ? replicates : 8;
+        vector<CharMatrix> fused(batch);
+        vector<const RandomWalk*> walk_ptrs;
+        vector<CharMatrix*> output_ptrs;
+        for(size_t k = 0; k < batch; k++){
+            walk_ptrs.push_back(&walks[k]);
+            output_ptrs.push_back(&fused[k]);
+        }
+        ResampleFused(input, walk_ptrs, output_ptrs);
+        for(size_t k = 0; k < batch; k++){
+            if(!SameMatrix(fused[k], Resample(input, walks[k]))){
+                cerr << "Error! ResampleFused differs from Resample on walk "
+                     << k << "." << endl;
+                return 1;
+            }
+        }
+    }
+
+    double coverage = 0;
+    for(const RandomWalk& walk : walks){
+        coverage += Coverage(walk, length);
+    }
+    cout << height << " taxa x " << length << " columns ("
+         << height * length / double(1 << 20) << "MB), " << replicates
+         << " replicates, each walk reads " << fixed << setprecision(1)
+         << 100 * coverage / replicates << "% of a row on average" << endl << endl;
+    cout << left << setw(8) << "K" << setw(22) << "unfused replicates/s"
+         << setw(20) << "fused replicates/s" << "speedup" << endl;
+
+    //Outputs are touched once first so that page faults aren't timed
+    vector<CharMatrix> outputs(max_k);
+    for(size_t i = 0; i < outputs.size(); i++){
+        Resample(input, walks[i % replicates], outputs[i]);
+    }
+    for(size_t k = 1; k <= max_k; k *= 2){
+        Clock::time_point start = Clock::now();
+        for(size_t i = 0; i < replicates; i++){
+            Resample(input, walks[i], outputs[i % k]);
+        }
+        double unfused = replicates / SecondsSince(start);
+
+        start = Clock::now();
+        for(size_t first = 0; first < replicates; first += k){
+            vector<const RandomWalk*> walk_ptrs;
+            vector<CharMatrix*> output_ptrs;
+            for(size_t i = first; i < first + k && i < replicates; i++){
+                walk_ptrs.push_back(&walks[i]);
+                output_ptrs.push_back(&outputs[i - first]);
+            }
+            ResampleFused(input, walk_ptrs, output_ptrs);
+        }
+        double fused = replicates / SecondsSince(start);
+        cout << left << fixed << setprecision(1) << setw(8) << k << setw(22)
+             << unfused << setw(20) << fused << setprecision(2)
+             << fused / unfused << "x" << endl;
+    }
+    return 0;
+}
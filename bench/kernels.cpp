@@ -0,0 +1,161 @@
+/* Checks every kernel set this CPU supports against the scalar set, then
+ * measures each kernel's throughput. Build with `make bench` and run as
+ *
+ *     bin/bench-kernels [megabytes] [repeats]
+ *
+ * The checks cover every size up to a few vector widths at every alignment,
+ * plus transposes of odd shapes, so the ragged edges are exercised as well as
+ * the vector loops. Exits with 1 if any set disagrees with the scalar one.
+ */
+
+#include "../src/kernels.hpp"
+
+#include <chrono>
+#include <cstring>
+using std::memcmp;
+#include <iostream>
+using std::cout; using std::cerr; using std::endl;
+#include <iomanip>
+using std::setw; using std::left; using std::fixed; using std::setprecision;
+#include <sstream>
+using std::ostringstream;
+#include <string>
+using std::string; using std::stoul; using std::to_string;
+#include <vector>
+using std::vector;
+#include <random>
+using std::mt19937_64; using std::uniform_int_distribution;
+
+typedef std::chrono::steady_clock Clock;
+
+//A buffer of random alignment characters
+static vector<char> RandomText(size_t size, mt19937_64& rng){
+    const char bases[] = "ACGT-N";
+    uniform_int_distribution<int> base_dist(0, 5);
+    vector<char> text(size);
+    for(char& c : text){
+        c = bases[base_dist(rng)];
+    }
+    return text;
+}
+
+//Compares one set against the scalar set, returns a description of the first
+//difference or an empty string.
+static string Check(const KernelSet& reference, const KernelSet& kernels,
+                    mt19937_64& rng){
+    vector<char> text = RandomText(4096, rng);
+    vector<char> expected(4096), found(4096);
+
+    for(size_t offset = 0; offset < 64; offset++){
+        for(size_t size = 0; size <= 256; size++){
+            reference.reverse_copy(expected.data(), text.data() + offset, size);
+            kernels.reverse_copy(found.data(), text.data() + offset, size);
+            if(memcmp(expected.data(), found.data(), size) != 0){
+                return "reverse_copy of " + to_string(size) + " bytes at offset " +
+                       to_string(offset);
+            }
+
+            //Put the newline somewhere in the range, or nowhere
+            vector<char> line(text.begin() + offset, text.begin() + offset + size);
+            if(size > 0 && offset % 4 != 0){
+                line[(offset * 7) % size] = '\n';
+            }
+            const char* end = line.data() + size;
+            if(reference.find_byte(line.data(), end, '\n') !=
+               kernels.find_byte(line.data(), end, '\n')){
+                return "find_byte in " + to_string(size) + " bytes";
+            }
+        }
+    }
+
+    uniform_int_distribution<size_t> shape_dist(0, 150);
+    for(size_t trial = 0; trial < 500; trial++){
+        size_t height = shape_dist(rng), length = shape_dist(rng);
+        size_t from_stride = length + trial % 5, to_stride = height + trial % 3;
+        vector<char> from = RandomText(height * from_stride + 1, rng);
+        vector<char> expected_to(length * to_stride + 1, 0);
+        vector<char> found_to(length * to_stride + 1, 0);
+        reference.transpose(from.data(), from_stride, height, length,
+                            expected_to.data(), to_stride);
+        kernels.transpose(from.data(), from_stride, height, length,
+                          found_to.data(), to_stride);
+        if(expected_to != found_to){
+            return "transpose of " + to_string(height) + "x" + to_string(length);
+        }
+    }
+    return "";
+}
+
+//Gigabytes a second from the best of several runs
+template<typename F>
+static double Throughput(size_t bytes, size_t repeats, F run){
+    double best = 0;
+    for(size_t i = 0; i < repeats; i++){
+        Clock::time_point start = Clock::now();
+        run();
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        if(seconds > 0 && bytes / seconds > best){
+            best = bytes / seconds;
+        }
+    }
+    return best / 1e9;
+}
+
+static string Rate(double gigabytes_per_second){
+    ostringstream stream;
+    stream << fixed << setprecision(2) << gigabytes_per_second << " GB/s";
+    return stream.str();
+}
+
+int main(int argc, char* argv[]){
+    size_t megabytes = argc > 1 ? stoul(argv[1]) : 64;
+    size_t repeats = argc > 2 ? stoul(argv[2]) : 5;
+    size_t size = megabytes << 20;
+
+    mt19937_64 rng(42);
+    vector<KernelSet> sets = SupportedKernelSets();
+    for(const KernelSet& kernels : sets){
+        string difference = Check(sets.front(), kernels, rng);
+        if(!difference.empty()){
+            cerr << "Error! The " << kernels.name << " kernels differ from the"
+                 << " scalar ones in " << difference << "." << endl;
+            return 1;
+        }
+    }
+    cout << "all " << sets.size() << " kernel sets match the scalar set, "
+         << ActiveKernelSet().name << " is active" << endl << endl;
+
+    //Reverse copies are timed in segments of a typical walk's length, the
+    //transpose on an alignment of 1000 taxa, and the scan over a text with a
+    //newline every 10kb.
+    vector<char> text = RandomText(size, rng);
+    vector<char> output(size);
+    const size_t segment = 100;
+    const size_t height = 1000, length = size / height;
+    for(size_t i = 10000; i < size; i += 10000){
+        text[i] = '\n';
+    }
+
+    cout << left << setw(10) << "set" << setw(16) << "reverse_copy"
+         << setw(16) << "transpose" << "find_byte" << endl;
+    for(const KernelSet& kernels : sets){
+        double reverse = Throughput(size, repeats, [&]{
+            for(size_t i = 0; i + segment <= size; i += segment){
+                kernels.reverse_copy(output.data() + i, text.data() + i, segment);
+            }
+        });
+        double transpose = Throughput(height * length, repeats, [&]{
+            kernels.transpose(text.data(), length, height, length,
+                              output.data(), height);
+        });
+        double scan = Throughput(size, repeats, [&]{
+            const char* end = text.data() + size;
+            for(const char* p = text.data(); p != end; p += p != end){
+                p = kernels.find_byte(p, end, '\n');
+            }
+        });
+        cout << left << setw(10) << kernels.name << setw(16) << Rate(reverse)
+             << setw(16) << Rate(transpose) << Rate(scan) << endl;
+    }
+    return 0;
+}
@@ -0,0 +1,85 @@
+/* Compares the compact walk representation against a plain vector of
+ * WalkSegments, the way walks used to be stored, for memory and for the
+ * latency of lookup_position. Build with `make bench` and run as
+ *
+ *     bin/bench-walk [replicate length] [bias] [lookups]
+ *
+ * The expected number of segments is roughly length * bias.
+ */
+
+#include "../src/walk.hpp"
+#include "../src/resample.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <algorithm>
+using std::upper_bound;
+#include <iostream>
+using std::cout; using std::cerr; using std::endl;
+#include <string>
+using std::string; using std::stoul; using std::stod;
+#include <vector>
+using std::vector;
+#include <random>
+using std::mt19937_64; using std::uniform_int_distribution;
+
+typedef std::chrono::steady_clock Clock;
+
+//How lookups worked on a vector of segments
+static size_t WideLookup(const vector<WalkSegment>& sequence, size_t pos){
+    auto iter = upper_bound(sequence.begin(), sequence.end(), pos,
+                [](size_t pos, const WalkSegment& ws){return ws.replicate_pos > pos;});
+    iter--;
+    size_t diff = pos - iter->replicate_pos;
+    if(iter->direction == Direction::Right){
+        return iter->original_pos + diff;
+    }
+    else{
+        return iter->original_pos - diff;
+    }
+}
+
+int main(int argc, char* argv[]){
+    size_t length = argc > 1 ? stoul(argv[1]) : 100000000;
+    double bias = argc > 2 ? stod(argv[2]) : 0.05;
+    size_t lookups = argc > 3 ? stoul(argv[3]) : 10000000;
+
+    mt19937_64 rng(42);
+    RandomWalk walk = GenerateRandomWalk(length, length, bias, rng);
+    vector<WalkSegment> sequence(walk.begin(), walk.end());
+
+    //The same random positions are looked up in both
+    vector<size_t> positions(lookups);
+    uniform_int_distribution<size_t> position_dist(0, length - 1);
+    for(size_t& pos : positions){
+        pos = position_dist(rng);
+    }
+
+    Clock::time_point start = Clock::now();
+    uint64_t wide_sum = 0;
+    for(size_t pos : positions){
+        wide_sum += WideLookup(sequence, pos);
+    }
+    double wide_seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    start = Clock::now();
+    uint64_t compact_sum = 0;
+    for(size_t pos : positions){
+        compact_sum += walk.lookup_position(pos);
+    }
+    double compact_seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    if(wide_sum != compact_sum){
+        cerr << "Error! The two representations gave different positions." << endl;
+        return 1;
+    }
+
+    double wide_bytes = sequence.size() * sizeof(WalkSegment);
+    cout << walk.size() << " segments, " << lookups << " lookups" << endl;
+    cout << "wide:    " << wide_bytes / (1 << 20) << " MiB, "
+         << 1e9 * wide_seconds / lookups << " ns per lookup" << endl;
+    cout << "compact: " << double(walk.memory_usage()) / (1 << 20) << " MiB, "
+         << 1e9 * compact_seconds / lookups << " ns per lookup"
+         << (walk.compact() ? "" : " (positions too large, stored wide)") << endl;
+    return 0;
+}
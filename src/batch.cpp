@@ -0,0 +1,172 @@
+#include "batch.hpp"
+#include "sequence.hpp"
+#include "walk.hpp"
+#include "resample.hpp"
+#include "pipeline.hpp"
+#include "threadpool.hpp"
+#include "binary.hpp"
+#include "dedup.hpp"
+
+#include <sys/stat.h>
+#include <cerrno>
+
+#include <cstdint>
+#include <memory>
+using std::shared_ptr; using std::make_shared;
+#include <mutex>
+using std::mutex; using std::lock_guard;
+#include <utility>
+using std::move;
+#include <set>
+using std::set;
+#include <stdexcept>
+using std::runtime_error;
+#include <sstream>
+using std::ostringstream;
+#include <istream>
+using std::istream;
+#include <ostream>
+using std::ostream; using std::endl;
+#include <string>
+using std::string; using std::to_string; using std::getline;
+#include <vector>
+using std::vector;
+#include <random>
+using std::mt19937_64;
+
+string LocusName(const string& path){
+    size_t slash = path.find_last_of('/');
+    string name = slash == string::npos ? path : path.substr(slash + 1);
+    size_t dot = name.find_last_of('.');
+    if(dot != string::npos && dot != 0){
+        name.erase(dot);
+    }
+    return name;
+}
+
+vector<string> ReadManifest(istream& stream){
+    vector<string> result;
+    string line;
+    while(getline(stream, line)){
+        if(line.size() == 0 || line[0] == '#'){
+            continue;
+        }
+        result.push_back(line);
+    }
+    return result;
+}
+
+//Everything replicate tasks of a locus share, kept alive by the tasks. If the
+//locus had duplicate rows, matrix only holds the unique ones and row_map says
+//which one every taxon gets.
+struct Locus{
+    string name;
+    CharMatrix matrix;
+    vector<string> taxa;
+    bool collapsed = false;
+    vector<size_t> row_map;
+};
+
+//State shared by every task in a batch run
+struct BatchState{
+    const BatchConfig& config;
+    uint64_t seed;
+    ThreadPool& pool;
+    mutex error_mutex;
+    set<string> failed;
+    ostream& errors;
+
+    BatchState(const BatchConfig& c, uint64_t s, ThreadPool& p, ostream& e):
+        config(c), seed(s), pool(p), errors(e){};
+
+    void fail(const string& locus, const string& message){
+        lock_guard<mutex> lock(error_mutex);
+        failed.insert(locus);
+        errors << "Error! Locus \"" << locus << "\": " << message << endl;
+    }
+};
+
+//Draw, resample and write a single replicate of a locus
+static void ReplicateTask(BatchState& state, shared_ptr<const Locus> locus,
+                          size_t length, size_t locus_index, size_t trial_num){
+    try{
+        mt19937_64 rng = ReplicateRNG(state.seed, trial_num, locus_index);
+        RandomWalk walk = GenerateRandomWalk(locus->matrix.length(), length,
+                                             state.config.bias, rng);
+        CharMatrix replicate = Resample(locus->matrix, walk);
+        string alignment;
+        FormatAlignment(state.config.format, alignment, replicate, locus->taxa,
+                        locus->collapsed ? &locus->row_map : nullptr);
+        ostringstream walk_text;
+        walk_text << walk << '\n';
+        WriteReplicateFiles(locus->name + "/replicate-" + to_string(trial_num),
+                            state.config.format, alignment, walk_text.str());
+    }
+    catch(std::exception& e){
+        state.fail(locus->name, e.what());
+    }
+}
+
+//Load a locus and fan out into replicate tasks
+static void LocusTask(BatchState& state, const string& path, size_t locus_index){
+    string name = LocusName(path);
+    shared_ptr<Locus> locus = make_shared<Locus>();
+    locus->name = name;
+
+    try{
+        ReadAlignmentFile(path, locus->matrix, locus->taxa);
+    }
+    catch(std::runtime_error& e){
+        state.fail(name, "\"" + path + "\" could not be read as an alignment");
+        return;
+    }
+    CharMatrix unique;
+    if(DeduplicateRows(locus->matrix, unique, locus->row_map)){
+        locus->matrix = move(unique);
+        locus->collapsed = true;
+    }
+    if(mkdir(name.c_str(), 0755) != 0 && errno != EEXIST){
+        state.fail(name, "could not create the directory \"" + name + "\"");
+        return;
+    }
+
+    //Every replicate has its own rng, so the result doesn't depend on the
+    //order tasks happen to be scheduled in.
+    size_t length = state.config.fixed_length ? state.config.length
+                                              : locus->matrix.length();
+
+    shared_ptr<const Locus> shared = locus;
+    size_t last = state.config.first + state.config.number;
+    for(size_t trial_num=state.config.first; trial_num<last; trial_num++){
+        BatchState* state_ptr = &state;
+        state.pool.submit([state_ptr, shared, length, locus_index, trial_num]{
+            ReplicateTask(*state_ptr, shared, length, locus_index, trial_num);
+        });
+    }
+}
+
+size_t RunBatch(const vector<string>& inputs, const BatchConfig& config,
+                uint64_t seed, ostream& errors){
+
+    //Two inputs with the same name would overwrite each other's replicates
+    set<string> names;
+    for(const string& path : inputs){
+        if(!names.insert(LocusName(path)).second){
+            throw runtime_error("More than one input is named \"" +
+                                LocusName(path) + "\"");
+        }
+    }
+
+    ThreadPool pool(config.threads);
+    BatchState state(config, seed, pool, errors);
+    for(size_t i = 0; i < inputs.size(); i++){
+        const string& path = inputs[i];
+        BatchState* state_ptr = &state;
+        pool.submit([state_ptr, path, i]{
+            LocusTask(*state_ptr, path, i);
+        });
+    }
+    pool.wait();
+
+    return state.failed.size();
+}
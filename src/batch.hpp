@@ -0,0 +1,44 @@
+/* Batch mode resamples many alignments (loci) in one process. Every locus
+ * becomes a task on a work stealing thread pool, which reads the alignment and
+ * then fans out into one task per replicate. Small loci
+ * finish quickly and their threads go on to steal replicates from the large
+ * ones, so a single big locus doesn't leave the other cores idle at the end.
+ *
+ * The output of each locus goes in its own subdirectory of the working
+ * directory, named after the input file without its extension.
+ */
+
+#pragma once
+
+#include "binary.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <ostream>
+
+struct BatchConfig{
+    size_t first = 1;           //Number of each locus' first replicate
+    size_t number = 1;          //Replicates per locus, numbered from first
+    bool fixed_length = false;  //If false, replicates match each locus' length
+    size_t length = 0;
+    double bias = 0.01;
+    size_t threads = 1;
+    AlignmentFormat format = AlignmentFormat::FASTA;  //Of the replicates
+};
+
+//The subdirectory used for a given input path, "dir/gene12.fasta" -> "gene12"
+std::string LocusName(const std::string& path);
+
+//Reads a manifest with one input path per line, blank lines and lines
+//starting with '#' are skipped.
+std::vector<std::string> ReadManifest(std::istream&);
+
+//Resample every input. Replicate N of the locus at position i of the input
+//list is drawn from ReplicateRNG(seed, N, i), so the first locus matches a
+//single input run with the same seed. Loci which can't be read or written are
+//reported to the errors stream and skipped, the number of failures is
+//returned. Throws std::runtime_error up front if two inputs share a name.
+size_t RunBatch(const std::vector<std::string>& inputs, const BatchConfig&,
+                uint64_t seed, std::ostream& errors);
@@ -0,0 +1,194 @@
+#include "binary.hpp"
+#include "sequence.hpp"
+#include "kernels.hpp"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstring>
+using std::memcpy; using std::memcmp; using std::memchr;
+#include <stdexcept>
+using std::runtime_error;
+#include <fstream>
+using std::ifstream;
+#include <ostream>
+using std::ostream;
+#include <string>
+using std::string;
+#include <vector>
+using std::vector;
+
+string FormatExtension(AlignmentFormat format){
+    if(format == AlignmentFormat::Binary){
+        return "sba";
+    }
+    return "fasta";
+}
+
+//Round an offset up to the next 64 byte boundary
+static uint64_t AlignOffset(uint64_t offset){
+    return (offset + 63) & ~uint64_t(63);
+}
+
+void ReadBinaryAlignment(const string& path, CharMatrix& matrix,
+                         vector<string>& taxa){
+    int fd = open(path.c_str(), O_RDONLY);
+    if(fd < 0){
+        throw runtime_error("Could not open \"" + path + "\"");
+    }
+    struct stat info;
+    if(fstat(fd, &info) != 0 || size_t(info.st_size) < sizeof(BinaryHeader)){
+        close(fd);
+        throw runtime_error("\"" + path + "\" is not a binary alignment");
+    }
+
+    //A private mapping is copy on write, so the matrix can still be modified
+    //without touching the file.
+    size_t size = info.st_size;
+    void* mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(mapping == MAP_FAILED){
+        throw runtime_error("Could not map \"" + path + "\"");
+    }
+    const char* base = static_cast<const char*>(mapping);
+
+    //Make sure the header makes sense before trusting any of it. The sizes are
+    //checked for overflow before they are added up and compared to the file's,
+    //and as with ReadFASTA an empty alignment isn't one.
+    BinaryHeader header;
+    memcpy(&header, base, sizeof(BinaryHeader));
+    bool sizes_valid = header.height != 0 && header.length != 0 &&
+        header.height <= UINT64_MAX / header.length &&
+        header.names_size <= UINT64_MAX - sizeof(BinaryHeader) &&
+        header.matrix_offset >= sizeof(BinaryHeader) + header.names_size &&
+        header.matrix_offset <= UINT64_MAX - header.height * header.length;
+    if(memcmp(header.magic, BINARY_MAGIC, sizeof(BINARY_MAGIC)) != 0 ||
+       header.version != BINARY_VERSION ||
+       (header.layout != MatrixLayout::RowMajor &&
+        header.layout != MatrixLayout::ColumnMajor) || !sizes_valid ||
+       header.matrix_offset + header.height * header.length != size){
+        munmap(mapping, size);
+        throw runtime_error("\"" + path + "\" is not a binary alignment");
+    }
+
+    //Read the names out of the name table
+    taxa.clear();
+    const char* name = base + sizeof(BinaryHeader);
+    const char* names_end = name + header.names_size;
+    for(size_t i = 0; i < header.height; i++){
+        const void* terminator = memchr(name, '\0', names_end - name);
+        if(terminator == nullptr){
+            munmap(mapping, size);
+            throw runtime_error("\"" + path + "\" has a bad name table");
+        }
+        taxa.push_back(string(name));
+        name = static_cast<const char*>(terminator) + 1;
+    }
+
+    //Row-major data is used right where it is, column-major is transposed
+    if(header.layout == MatrixLayout::RowMajor){
+        matrix = CharMatrix::FromMapping(mapping, size, header.matrix_offset,
+                                         header.height, header.length);
+        return;
+    }
+    CharMatrix transposed(header.height, header.length);
+    TransposeBytes(base + header.matrix_offset, header.height, header.length,
+                   header.height, transposed.row(0), header.length);
+    munmap(mapping, size);
+    matrix = std::move(transposed);
+}
+
+void FormatBinaryAlignment(string& buffer, const CharMatrix& matrix,
+                           const vector<string>& taxa, MatrixLayout layout,
+                           const vector<size_t>* rows){
+    size_t height = rows == nullptr ? matrix.height() : rows->size();
+    auto source = [rows](size_t row_index){
+        return rows == nullptr ? row_index : (*rows)[row_index];
+    };
+    if(taxa.size() != height){
+        throw runtime_error("Number of taxa does not match the alignment");
+    }
+
+    BinaryHeader header;
+    memcpy(header.magic, BINARY_MAGIC, sizeof(BINARY_MAGIC));
+    header.version = BINARY_VERSION;
+    header.layout = layout;
+    header.height = height;
+    header.length = matrix.length();
+    header.names_size = 0;
+    for(const string& taxon : taxa){
+        header.names_size += taxon.size() + 1;
+    }
+    header.matrix_offset = AlignOffset(sizeof(BinaryHeader) + header.names_size);
+
+    buffer.clear();
+    buffer.reserve(header.matrix_offset + header.height * header.length);
+    buffer.append(reinterpret_cast<const char*>(&header), sizeof(BinaryHeader));
+    for(const string& taxon : taxa){
+        buffer.append(taxon.c_str(), taxon.size() + 1);
+    }
+    buffer.resize(header.matrix_offset, '\0');
+
+    if(layout == MatrixLayout::RowMajor){
+        for(size_t row_index = 0; row_index < height; row_index++){
+            buffer.append(matrix.row(source(row_index)), matrix.length());
+        }
+        return;
+    }
+    if(rows == nullptr){
+        buffer.resize(header.matrix_offset + height * matrix.length());
+        TransposeBytes(matrix.row(0), matrix.length(), height, matrix.length(),
+                       &buffer[header.matrix_offset], height);
+        return;
+    }
+    for(size_t col_index = 0; col_index < matrix.length(); col_index++){
+        for(size_t row_index = 0; row_index < height; row_index++){
+            buffer += matrix.get(source(row_index), col_index);
+        }
+    }
+}
+
+void WriteBinaryAlignment(ostream& stream, const CharMatrix& matrix,
+                          const vector<string>& taxa, MatrixLayout layout){
+    string buffer;
+    FormatBinaryAlignment(buffer, matrix, taxa, layout);
+    stream.write(buffer.data(), buffer.size());
+    if(!stream){
+        throw runtime_error("Could not write the binary alignment");
+    }
+}
+
+void ReadAlignmentFile(const string& path, CharMatrix& matrix,
+                       vector<string>& taxa){
+    ifstream file(path, std::ios::binary);
+    if(!file.is_open()){
+        throw runtime_error("Could not open \"" + path + "\"");
+    }
+
+    //Peek at the magic to decide how to read the rest
+    char magic[sizeof(BINARY_MAGIC)] = {0};
+    file.read(magic, sizeof(magic));
+    if(file.gcount() == sizeof(magic) &&
+       memcmp(magic, BINARY_MAGIC, sizeof(BINARY_MAGIC)) == 0){
+        file.close();
+        ReadBinaryAlignment(path, matrix, taxa);
+        return;
+    }
+    file.clear();
+    file.seekg(0);
+    ReadFASTA(file, matrix, taxa);
+}
+
+void FormatAlignment(AlignmentFormat format, string& buffer,
+                     const CharMatrix& matrix, const vector<string>& taxa,
+                     const vector<size_t>* rows){
+    if(format == AlignmentFormat::Binary){
+        FormatBinaryAlignment(buffer, matrix, taxa, MatrixLayout::RowMajor, rows);
+    }
+    else{
+        FormatFASTA(buffer, matrix, taxa, rows);
+    }
+}
@@ -0,0 +1,73 @@
+/* A binary alignment format which can be loaded with a single mmap and no
+ * parsing, as an alternative to FASTA for tools which exchange alignments with
+ * each other. Files are laid out as
+ *
+ *     BinaryHeader
+ *     taxa names          height null terminated strings, back to back
+ *     (padding)           up to a 64 byte boundary
+ *     matrix              height * length chars
+ *
+ * The matrix is stored row-major (a row per taxon) unless the layout says
+ * column-major. Row-major files are used in place by CharMatrix, column-major
+ * files are transposed as they are read. Integers are in native byte order.
+ * The conventional extension is .sba.
+ */
+
+#pragma once
+
+#include "sequence.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <ostream>
+
+const char BINARY_MAGIC[8] = {'S', 'E', 'R', 'E', 'S', 'A', 'L', 'N'};
+const uint32_t BINARY_VERSION = 1;
+
+enum class MatrixLayout : uint32_t{RowMajor = 0, ColumnMajor = 1};
+
+struct BinaryHeader{
+    char magic[8];
+    uint32_t version;
+    MatrixLayout layout;
+    uint64_t height;
+    uint64_t length;
+    uint64_t names_size;        //Bytes taken by the name table
+    uint64_t matrix_offset;     //From the start of the file
+};
+
+//The formats alignments can be read and written in
+enum class AlignmentFormat{FASTA, Binary};
+
+//The file extension used for each format, without the dot
+std::string FormatExtension(AlignmentFormat);
+
+//Loads a binary alignment by mapping it. Throws std::runtime_error if the file
+//can't be mapped or isn't a binary alignment.
+void ReadBinaryAlignment(const std::string& path, CharMatrix&,
+                         std::vector<std::string>&);
+
+//Write a binary alignment to a stream, or format it into a buffer replacing
+//its contents. Both throw std::runtime_error if taxa.size() != height. Rows
+//maps output rows to matrix rows, as for FormatFASTA.
+void WriteBinaryAlignment(std::ostream&, const CharMatrix&,
+                          const std::vector<std::string>&,
+                          MatrixLayout = MatrixLayout::RowMajor);
+void FormatBinaryAlignment(std::string&, const CharMatrix&,
+                           const std::vector<std::string>&,
+                           MatrixLayout = MatrixLayout::RowMajor,
+                           const std::vector<size_t>* rows = nullptr);
+
+//Reads an alignment in either format, telling them apart by the magic at the
+//start of the file. Throws std::runtime_error if the file can't be opened or
+//doesn't hold an alignment.
+void ReadAlignmentFile(const std::string& path, CharMatrix&,
+                       std::vector<std::string>&);
+
+//Format an alignment in the given format into a buffer, rows is passed on to
+//FormatFASTA or FormatBinaryAlignment
+void FormatAlignment(AlignmentFormat, std::string&, const CharMatrix&,
+                     const std::vector<std::string>&,
+                     const std::vector<size_t>* rows = nullptr);
@@ -0,0 +1,337 @@
+#include "daemon.hpp"
+#include "sequence.hpp"
+#include "walk.hpp"
+#include "resample.hpp"
+#include "pipeline.hpp"
+#include "manifest.hpp"
+#include "diagnostics.hpp"
+#include "translate.hpp"
+#include "binary.hpp"
+
+#include <cstdint>
+#include <stdexcept>
+using std::runtime_error;
+#include <sstream>
+using std::ostringstream; using std::istringstream;
+#include <string>
+using std::string; using std::to_string;
+#include <vector>
+using std::vector;
+#include <map>
+using std::map;
+#include <random>
+using std::mt19937_64;
+
+typedef map<string, string> Options;
+
+//Complain about any option a command doesn't know, typos would otherwise be
+//silently replaced by defaults.
+static void CheckOptions(const Options& options, const vector<string>& known){
+    for(const auto& option : options){
+        bool found = false;
+        for(const string& key : known){
+            found = found || key == option.first;
+        }
+        if(!found){
+            throw runtime_error("Unknown option \"" + option.first + "\"");
+        }
+    }
+}
+
+//An option parsed as a non-negative integer, or a default if it isn't given
+static uint64_t SizeOption(const Options& options, const string& key,
+                           uint64_t default_value){
+    auto found = options.find(key);
+    if(found == options.end()){
+        return default_value;
+    }
+    try{
+        if(found->second.empty() || found->second[0] == '-'){
+            throw std::invalid_argument(found->second);
+        }
+        return std::stoull(found->second);
+    }
+    catch(std::logic_error& e){
+        throw runtime_error("The " + key + " \"" + found->second + "\" is not a"
+                            " non-negative integer");
+    }
+}
+
+//An option which must be given
+static uint64_t RequiredSizeOption(const Options& options, const string& key){
+    if(options.count(key) == 0){
+        throw runtime_error("The " + key + " option is required");
+    }
+    return SizeOption(options, key, 0);
+}
+
+//The bias option, checked the same way seres-resample checks it
+static double BiasOption(const Options& options){
+    auto found = options.find("bias");
+    if(found == options.end()){
+        return 0.01;
+    }
+    double bias;
+    try{
+        bias = std::stod(found->second);
+    }
+    catch(std::logic_error& e){
+        throw runtime_error("The bias \"" + found->second + "\" is not a number");
+    }
+    if(bias < 0 || bias >= 1){
+        throw runtime_error("The bias must be in (0..1]");
+    }
+    return bias;
+}
+
+//The range option, either a single replicate N or START:END. Replicates are
+//numbered from 1, the default is just replicate 1.
+static void RangeOption(const Options& options, size_t& first, size_t& number){
+    first = 1;
+    number = 1;
+    auto found = options.find("range");
+    if(found == options.end()){
+        return;
+    }
+    const string& range = found->second;
+    size_t colon = range.find(':');
+    size_t last;
+    try{
+        first = std::stoul(range.substr(0, colon));
+        last = colon == string::npos ? first : std::stoul(range.substr(colon + 1));
+    }
+    catch(std::logic_error& e){
+        throw runtime_error("The range \"" + range + "\" is not of the form"
+                            " START:END");
+    }
+    if(first == 0 || last < first){
+        throw runtime_error("The range must have 1 <= START <= END");
+    }
+    number = last - first + 1;
+}
+
+//The format option, fasta or binary
+static AlignmentFormat FormatOption(const Options& options){
+    auto found = options.find("format");
+    if(found == options.end() || found->second == "fasta"){
+        return AlignmentFormat::FASTA;
+    }
+    if(found->second == "binary"){
+        return AlignmentFormat::Binary;
+    }
+    throw runtime_error("The format \"" + found->second + "\" must be either"
+                        " fasta or binary");
+}
+
+Daemon::Daemon():
+    alignments_([](const string& path, LoadedAlignment& alignment){
+        ReadAlignmentFile(path, alignment.matrix, alignment.taxa);
+    }),
+    walks_([](const string& path, RandomWalk& walk){
+        walk = ReadWalkFile(path);
+    }),
+    requests_(0){}
+
+string Daemon::handle(const string& request){
+    requests_++;
+    try{
+        //Split off the body, then split the first line into its arguments
+        size_t newline = request.find('\n');
+        string line = request.substr(0, newline);
+        string body = newline == string::npos ? "" : request.substr(newline + 1);
+        vector<string> arguments;
+        istringstream line_stream(line);
+        string argument;
+        while(getline(line_stream, argument, '\t')){
+            arguments.push_back(argument);
+        }
+        if(arguments.empty()){
+            throw runtime_error("Empty request");
+        }
+
+        string command = arguments[0];
+        string target = arguments.size() > 1 ? arguments[1] : "";
+        Options options;
+        for(size_t i = 2; i < arguments.size(); i++){
+            size_t equals = arguments[i].find('=');
+            if(equals == string::npos){
+                throw runtime_error("Expected key=value but found \"" +
+                                    arguments[i] + "\"");
+            }
+            options[arguments[i].substr(0, equals)] =
+                arguments[i].substr(equals + 1);
+        }
+
+        bool needs_target = command == "resample" || command == "walk" ||
+                            command == "translate" || command == "coverage";
+        if(needs_target && target.empty()){
+            throw runtime_error("The " + command + " command needs a path");
+        }
+
+        if(command == "ping"){
+            return "ok\npong\n";
+        }
+        else if(command == "stats"){
+            return "ok\n" + stats();
+        }
+        else if(command == "clear"){
+            alignments_.clear();
+            walks_.clear();
+            return "ok\n";
+        }
+        else if(command == "resample"){
+            return "ok\n" + resample(target, options);
+        }
+        else if(command == "walk"){
+            return "ok\n" + walk(target, options);
+        }
+        else if(command == "translate"){
+            return "ok\n" + translate(target, options, body);
+        }
+        else if(command == "coverage"){
+            return "ok\n" + coverage(target, options);
+        }
+        throw runtime_error("Unknown command \"" + command + "\"");
+    }
+    catch(std::exception& e){
+        return string("error\n") + e.what();
+    }
+}
+
+string Daemon::resample(const string& target, const Options& options){
+    CheckOptions(options, {"seed", "range", "bias", "length", "format", "dir"});
+    std::shared_ptr<const LoadedAlignment> input = alignments_.get(target);
+
+    PipelineConfig config;
+    config.seed = RequiredSizeOption(options, "seed");
+    RangeOption(options, config.first, config.number);
+    config.bias = BiasOption(options);
+    config.length = SizeOption(options, "length", input->matrix.length());
+    config.format = FormatOption(options);
+
+    //Without a directory, a single replicate comes back in the response
+    auto dir = options.find("dir");
+    if(dir == options.end()){
+        if(config.number != 1){
+            throw runtime_error("Only one replicate can be returned at a time,"
+                                " use dir= to write a range of them");
+        }
+        mt19937_64 rng = ReplicateRNG(config.seed, config.first);
+        RandomWalk walk = GenerateRandomWalk(input->matrix.length(),
+                                             config.length, config.bias, rng);
+        CharMatrix replicate;
+        Resample(input->matrix, walk, replicate);
+        string alignment;
+        FormatAlignment(config.format, alignment, replicate, input->taxa);
+        return alignment;
+    }
+
+    //Otherwise write the files along with a manifest, as seres-resample
+    //--incremental does. Replicates the directory already holds intact aren't
+    //written again, and whatever the manifest lists outside the range is kept.
+    config.directory = dir->second;
+    config.manifest = MANIFEST_FILE;
+    string manifest_path = config.directory + "/" + MANIFEST_FILE;
+    RunManifest manifest, previous;
+    manifest.parameters = ManifestParameters(config, input->matrix, input->taxa);
+    if(ReadRunManifest(manifest_path, previous)){
+        for(const auto& parameter : manifest.parameters){
+            if(previous.parameters[parameter.first] != parameter.second){
+                throw runtime_error("The replicates in \"" + config.directory +
+                                    "\" were made with a different " +
+                                    parameter.first);
+            }
+        }
+        config.skip = VerifyReplicates(previous, config.directory, config.format,
+                                       config.first, config.number,
+                                       config.threads);
+        manifest.replicates = previous.replicates;
+        auto begin = manifest.replicates.lower_bound(config.first);
+        auto end = manifest.replicates.lower_bound(config.first + config.number);
+        manifest.replicates.erase(begin, end);
+        for(size_t replicate : config.skip){
+            manifest.replicates[replicate] = previous.replicates[replicate];
+        }
+    }
+    WriteRunManifest(manifest_path, manifest);
+    RunResamplePipeline(config, input->matrix, input->taxa);
+    return "wrote " + to_string(config.number - config.skip.size()) +
+           " replicates to " + config.directory + ", " +
+           to_string(config.skip.size()) + " were already there\n";
+}
+
+string Daemon::walk(const string& target, const Options& options){
+    CheckOptions(options, {"seed", "range", "bias", "length"});
+    std::shared_ptr<const LoadedAlignment> input = alignments_.get(target);
+    size_t first, number;
+    RangeOption(options, first, number);
+    if(number != 1){
+        throw runtime_error("Only one walk can be returned at a time");
+    }
+    mt19937_64 rng = ReplicateRNG(RequiredSizeOption(options, "seed"), first);
+    RandomWalk walk = GenerateRandomWalk(input->matrix.length(),
+        SizeOption(options, "length", input->matrix.length()),
+        BiasOption(options), rng);
+    ostringstream result;
+    result << walk << '\n';
+    return result.str();
+}
+
+string Daemon::translate(const string& target, const Options& options,
+                         const string& body){
+    CheckOptions(options, {"mode", "sep"});
+    std::shared_ptr<const RandomWalk> walk = walks_.get(target);
+
+    char separator = ',';
+    auto sep = options.find("sep");
+    if(sep != options.end() && sep->second.size() == 1){
+        separator = sep->second[0];
+    }
+    auto mode = options.find("mode");
+    string mode_name = mode == options.end() ? "position" : mode->second;
+
+    istringstream input(body);
+    ostringstream result;
+    if(mode_name == "interval"){
+        TranslateIntervals(*walk, ReadIntervals(input, separator), result);
+    }
+    else if(mode_name == "position" || mode_name == "breakpoint"){
+        vector<size_t> locations;
+        try{
+            locations = ReadLocations(input, separator);
+        }
+        catch(std::logic_error& e){
+            throw runtime_error("The locations could not be read as numbers");
+        }
+        TranslateLocations(*walk, locations, mode_name == "breakpoint", result);
+    }
+    else{
+        throw runtime_error("The mode \"" + mode_name + "\" must be position,"
+                            " breakpoint or interval");
+    }
+    return result.str();
+}
+
+string Daemon::coverage(const string& target, const Options& options){
+    CheckOptions(options, {"seed", "range", "bias", "length"});
+    std::shared_ptr<const LoadedAlignment> input = alignments_.get(target);
+
+    CoverageConfig config;
+    config.seed = RequiredSizeOption(options, "seed");
+    RangeOption(options, config.first, config.number);
+    config.bias = BiasOption(options);
+    config.length = SizeOption(options, "length", input->matrix.length());
+    ostringstream result;
+    result << ComputeCoverage(config, input->matrix.length());
+    return result.str();
+}
+
+string Daemon::stats(){
+    return "requests\t" + to_string(requests_) + "\n" +
+           "alignments\t" + to_string(alignments_.size()) + "\t" +
+           to_string(alignments_.hits()) + " hits\t" +
+           to_string(alignments_.misses()) + " misses\n" +
+           "walks\t" + to_string(walks_.size()) + "\t" +
+           to_string(walks_.hits()) + " hits\t" +
+           to_string(walks_.misses()) + " misses\n";
+}
@@ -0,0 +1,172 @@
+/* The request handling behind seres-daemon, which keeps parsed alignments and
+ * walks in memory between requests so that callers making thousands of small
+ * requests against the same few files only pay for parsing them once. The
+ * socket and the framing are in seres-daemon.cpp and protocol.hpp, this only
+ * turns a request into a response.
+ *
+ * Commands, with the first argument positional and the rest key=value:
+ *
+ *     ping                          answers "pong"
+ *     stats                         what is cached and how often it was reused
+ *     clear                         drops everything cached
+ *     resample <alignment>          one replicate, formatted as an alignment.
+ *         seed=S range=N            Or with dir=D, replicates range=A:B are
+ *         [bias= length= format=]   written to D exactly as seres-resample
+ *         [dir=D]                   would write them, and a summary is returned.
+ *                                   Intact replicates D already holds are kept
+ *                                   as with seres-resample --incremental.
+ *     walk <alignment> seed=S       the walk of replicate N, as in a .walk file
+ *         range=N [bias= length=]
+ *     translate <walk file>         the locations in the body translated as by
+ *         [mode= sep=]              seres-translate, mode is position (the
+ *                                   default), breakpoint or interval
+ *     coverage <alignment> seed=S   the report of seres-resample --diagnostics
+ *         [range= bias= length=]
+ *
+ * Replicates are drawn with ReplicateRNG, so they are identical to the ones
+ * seres-resample writes with the same seed. Bias defaults to 0.01 and length
+ * to the alignment's length, as they do for seres-resample.
+ */
+
+#pragma once
+
+#include "sequence.hpp"
+#include "walk.hpp"
+
+#include <sys/stat.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+//Parsed files kept in memory, keyed by path. A file is loaded again if its size
+//or modification time has changed since it was cached. Requests for a file
+//which is still being loaded wait for that load rather than starting another.
+template<typename T>
+class FileCache{
+    private:
+        struct Entry{
+            off_t size;
+            int64_t modified;       //Nanoseconds since the epoch
+            uint64_t generation;    //Tells apart loads of the same path
+            std::shared_future<std::shared_ptr<const T>> value;
+        };
+
+        std::function<void(const std::string&, T&)> load_;
+        std::mutex mutex_;
+        std::map<std::string, Entry> entries_;
+        uint64_t next_generation_ = 0;
+        std::atomic<size_t> hits_;
+        std::atomic<size_t> misses_;
+
+    public:
+
+        //Load fills a T from a path, throwing std::runtime_error on failure
+        explicit FileCache(std::function<void(const std::string&, T&)> load):
+            load_(load), hits_(0), misses_(0){};
+
+        //The parsed contents of a file, loading it if need be. Throws
+        //std::runtime_error if the file can't be loaded. Failed loads aren't
+        //cached.
+        std::shared_ptr<const T> get(const std::string& path){
+            struct stat info;
+            if(stat(path.c_str(), &info) != 0){
+                throw std::runtime_error("Could not open \"" + path + "\"");
+            }
+            int64_t modified = int64_t(info.st_mtim.tv_sec) * 1000000000 +
+                               info.st_mtim.tv_nsec;
+
+            std::promise<std::shared_ptr<const T>> promise;
+            std::shared_future<std::shared_ptr<const T>> value;
+            uint64_t generation = 0;
+            bool loading = false;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                auto found = entries_.find(path);
+                if(found != entries_.end() && found->second.size == info.st_size &&
+                   found->second.modified == modified){
+                    value = found->second.value;
+                    hits_++;
+                }
+                else{
+                    value = promise.get_future().share();
+                    generation = next_generation_++;
+                    entries_[path] = Entry{info.st_size, modified, generation, value};
+                    loading = true;
+                    misses_++;
+                }
+            }
+
+            if(loading){
+                try{
+                    std::shared_ptr<T> loaded = std::make_shared<T>();
+                    load_(path, *loaded);
+                    promise.set_value(loaded);
+                }
+                catch(...){
+                    promise.set_exception(std::current_exception());
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    auto found = entries_.find(path);
+                    if(found != entries_.end() &&
+                       found->second.generation == generation){
+                        entries_.erase(found);
+                    }
+                }
+            }
+            return value.get();
+        }
+
+        //Forget everything, requests already holding a file keep it
+        void clear(){
+            std::lock_guard<std::mutex> lock(mutex_);
+            entries_.clear();
+        }
+
+        size_t size(){
+            std::lock_guard<std::mutex> lock(mutex_);
+            return entries_.size();
+        }
+        size_t hits() const{return hits_;};
+        size_t misses() const{return misses_;};
+};
+
+//An input alignment as it is cached
+struct LoadedAlignment{
+    CharMatrix matrix;
+    std::vector<std::string> taxa;
+};
+
+//Answers requests, safe to call from any number of threads at once
+class Daemon{
+    private:
+        FileCache<LoadedAlignment> alignments_;
+        FileCache<RandomWalk> walks_;
+        std::atomic<size_t> requests_;
+
+        std::string resample(const std::string& target,
+                             const std::map<std::string, std::string>& options);
+        std::string walk(const std::string& target,
+                         const std::map<std::string, std::string>& options);
+        std::string translate(const std::string& target,
+                              const std::map<std::string, std::string>& options,
+                              const std::string& body);
+        std::string coverage(const std::string& target,
+                             const std::map<std::string, std::string>& options);
+        std::string stats();
+
+    public:
+        Daemon();
+
+        //Turn a request frame into a response frame, see protocol.hpp. Errors
+        //are reported in the response, this never throws.
+        std::string handle(const std::string& request);
+};
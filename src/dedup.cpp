@@ -0,0 +1,48 @@
+#include "dedup.hpp"
+#include "sequence.hpp"
+#include "manifest.hpp"
+
+#include <cstdint>
+#include <cstring>
+using std::memcmp; using std::memcpy;
+#include <unordered_map>
+using std::unordered_map;
+#include <vector>
+using std::vector;
+
+bool DeduplicateRows(const CharMatrix& input, CharMatrix& unique,
+                     vector<size_t>& row_map){
+
+    //Rows with equal hashes are only merged if they really are equal
+    size_t length = input.length();
+    unordered_map<uint64_t, vector<size_t>> buckets;
+    vector<size_t> representatives;     //Input row holding each unique row
+    vector<size_t> mapping(input.height());
+    for(size_t row_index = 0; row_index < input.height(); row_index++){
+        const char* row = input.row(row_index);
+        vector<size_t>& bucket = buckets[Checksum(row, length)];
+        bool found = false;
+        for(size_t candidate : bucket){
+            if(memcmp(input.row(representatives[candidate]), row, length) == 0){
+                mapping[row_index] = candidate;
+                found = true;
+                break;
+            }
+        }
+        if(!found){
+            mapping[row_index] = representatives.size();
+            bucket.push_back(representatives.size());
+            representatives.push_back(row_index);
+        }
+    }
+
+    if(representatives.size() == input.height()){
+        return false;
+    }
+    unique = CharMatrix(representatives.size(), length);
+    for(size_t i = 0; i < representatives.size(); i++){
+        memcpy(unique.row(i), input.row(representatives[i]), length);
+    }
+    row_map.swap(mapping);
+    return true;
+}
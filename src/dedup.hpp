@@ -0,0 +1,24 @@
+/* Collapsing of identical rows. Alignments of outbreak samples often hold large
+ * blocks of identical sequences, and identical input rows always give
+ * identical replicate rows. So rather than resampling every row, the distinct
+ * rows are found once when the input is loaded, only those are resampled, and
+ * each duplicate is written out by copying its unique row's bytes (see the
+ * rows argument of FormatAlignment).
+ *
+ * Rows are bucketed by a hash of their contents and every candidate match is
+ * confirmed with a full comparison, so collisions can't merge different rows.
+ */
+
+#pragma once
+
+#include "sequence.hpp"
+
+#include <cstddef>
+#include <vector>
+
+//Finds the distinct rows of a matrix. If there are duplicates, unique is
+//filled with one copy of each distinct row in order of first appearance,
+//row_map with the unique row of every input row, and true is returned. If
+//every row is distinct nothing is copied and false is returned.
+bool DeduplicateRows(const CharMatrix& input, CharMatrix& unique,
+                     std::vector<size_t>& row_map);
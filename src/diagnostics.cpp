@@ -0,0 +1,263 @@
+#include "diagnostics.hpp"
+#include "partition.hpp"
+#include "resample.hpp"
+#include "walk.hpp"
+
+#include <cmath>
+using std::sqrt; using std::ceil;
+#include <cstdint>
+#include <algorithm>
+using std::sort; using std::min; using std::max; using std::upper_bound;
+#include <atomic>
+using std::atomic;
+#include <thread>
+using std::thread;
+#include <iomanip>
+using std::setw; using std::fixed; using std::setprecision; using std::left;
+#include <ostream>
+using std::ostream; using std::endl;
+#include <vector>
+using std::vector;
+#include <random>
+using std::mt19937_64;
+
+//What a single thread accumulates, merged into the report at the end
+struct CoverageTally{
+    vector<int64_t> difference;
+    uint64_t runs = 0;
+    uint64_t clipped_runs = 0;
+    double run_length_sum = 0;
+    double run_length_sum_squares = 0;
+    uint64_t longest_run = 0;
+    vector<uint64_t> run_length_buckets = vector<uint64_t>(64, 0);
+};
+
+//Index of the highest set bit, the log2 bucket of a run length
+static size_t Log2Bucket(uint64_t value){
+    size_t bucket = 0;
+    while(value >>= 1){
+        bucket++;
+    }
+    return bucket;
+}
+
+//Add one walk to a tally. Regions must be sorted by start.
+static void TallyWalk(const RandomWalk& walk, const vector<Partition>& regions,
+                      CoverageTally& tally){
+    for(const WalkSegment& ws : walk){
+        size_t low, high;
+        if(ws.direction == Direction::Right){
+            low = ws.original_pos;
+            high = ws.original_pos + ws.length - 1;
+        }
+        else{
+            low = ws.original_pos - ws.length + 1;
+            high = ws.original_pos;
+        }
+        tally.difference[low]++;
+        tally.difference[high + 1]--;
+
+        //Find the region this run was in to see if it hit the edge
+        auto region = upper_bound(regions.begin(), regions.end(), low,
+            [](size_t column, const Partition& p){return p.start > column;});
+        region--;
+        if((ws.direction == Direction::Right && high + 1 == region->end) ||
+           (ws.direction == Direction::Left && low == region->start)){
+            tally.clipped_runs++;
+        }
+
+        tally.runs++;
+        tally.run_length_sum += ws.length;
+        tally.run_length_sum_squares += double(ws.length) * ws.length;
+        tally.longest_run = max<uint64_t>(tally.longest_run, ws.length);
+        tally.run_length_buckets[Log2Bucket(ws.length)]++;
+    }
+}
+
+CoverageReport ComputeCoverage(const CoverageConfig& config,
+                               size_t input_length){
+
+    CoverageReport report;
+    report.walks = config.number;
+    report.walk_length = config.length;
+    report.regions = config.partitions;
+    if(report.regions.empty()){
+        report.regions.push_back(Partition{0, input_length});
+    }
+    vector<Partition> sorted_regions = report.regions;
+    sort(sorted_regions.begin(), sorted_regions.end(),
+         [](const Partition& a, const Partition& b){return a.start < b.start;});
+    vector<size_t> partition_lengths;
+    if(!config.partitions.empty()){
+        partition_lengths = PartitionLengths(config.partitions, config.length);
+    }
+
+    //Every thread grabs walks off a shared counter into its own tally
+    size_t threads = max<size_t>(1, min(config.threads, config.number));
+    vector<CoverageTally> tallies(threads);
+    atomic<size_t> next(0);
+    vector<thread> workers;
+    for(size_t t = 0; t < threads; t++){
+        workers.push_back(thread([&, t]{
+            CoverageTally& tally = tallies[t];
+            tally.difference.assign(input_length + 1, 0);
+            size_t index;
+            while((index = next++) < config.number){
+                mt19937_64 walk_rng = ReplicateRNG(config.seed,
+                                                   config.first + index);
+                RandomWalk walk;
+                if(config.partitions.empty()){
+                    walk = GenerateRandomWalk(input_length, config.length,
+                                              config.bias, walk_rng);
+                }
+                else{
+                    walk = GeneratePartitionedWalk(config.partitions,
+                        partition_lengths, config.bias, walk_rng);
+                }
+                TallyWalk(walk, sorted_regions, tally);
+            }
+        }));
+    }
+    for(thread& worker : workers){
+        worker.join();
+    }
+
+    //Merge the tallies and turn the differences into coverage
+    vector<int64_t> difference(input_length + 1, 0);
+    report.run_length_buckets.assign(64, 0);
+    for(const CoverageTally& tally : tallies){
+        for(size_t column = 0; column <= input_length; column++){
+            difference[column] += tally.difference[column];
+        }
+        report.runs += tally.runs;
+        report.clipped_runs += tally.clipped_runs;
+        report.run_length_sum += tally.run_length_sum;
+        report.run_length_sum_squares += tally.run_length_sum_squares;
+        report.longest_run = max(report.longest_run, tally.longest_run);
+        for(size_t b = 0; b < 64; b++){
+            report.run_length_buckets[b] += tally.run_length_buckets[b];
+        }
+    }
+    report.coverage.assign(input_length, 0);
+    int64_t running = 0;
+    for(size_t column = 0; column < input_length; column++){
+        running += difference[column];
+        report.coverage[column] = running;
+    }
+
+    return report;
+}
+
+//Mean and standard deviation of a set of counts
+static void MeanAndDeviation(const vector<uint64_t>& values, double& mean,
+                             double& deviation){
+    double sum = 0;
+    double sum_squares = 0;
+    for(uint64_t value : values){
+        sum += value;
+        sum_squares += double(value) * value;
+    }
+    mean = values.empty() ? 0 : sum / values.size();
+    double variance = values.empty() ? 0 : sum_squares / values.size() - mean * mean;
+    deviation = sqrt(max(0.0, variance));
+}
+
+ostream& operator<<(ostream& stream, const CoverageReport& report){
+
+    //Only columns inside a region could ever be visited
+    vector<uint64_t> covered;
+    size_t width = 0;
+    for(const Partition& region : report.regions){
+        covered.insert(covered.end(), report.coverage.begin() + region.start,
+                       report.coverage.begin() + region.end);
+        width += region.width();
+    }
+    double mean, deviation;
+    MeanAndDeviation(covered, mean, deviation);
+    vector<uint64_t> sorted = covered;
+    sort(sorted.begin(), sorted.end());
+    auto quantile = [&sorted](double q){
+        return sorted.empty() ? 0 : sorted[size_t(q * (sorted.size() - 1))];
+    };
+    size_t uncovered = 0;
+    for(uint64_t value : covered){
+        if(value == 0){
+            uncovered++;
+        }
+    }
+
+    stream << fixed << setprecision(3);
+    stream << report.walks << " walks of length " << report.walk_length
+           << " over " << width << " columns in " << report.regions.size()
+           << (report.regions.size() == 1 ? " region" : " regions") << endl;
+
+    stream << endl << "coverage per column:" << endl;
+    stream << left << setw(14) << "  expected"
+           << (width == 0 ? 0.0 : double(report.walks) * report.walk_length / width)
+           << endl;
+    stream << setw(14) << "  mean" << mean << endl;
+    stream << setw(14) << "  sd" << deviation << " (cv "
+           << (mean == 0 ? 0.0 : deviation / mean) << ")" << endl;
+    stream << setw(14) << "  min" << quantile(0) << endl;
+    stream << setw(14) << "  5%" << quantile(0.05) << endl;
+    stream << setw(14) << "  25%" << quantile(0.25) << endl;
+    stream << setw(14) << "  median" << quantile(0.5) << endl;
+    stream << setw(14) << "  75%" << quantile(0.75) << endl;
+    stream << setw(14) << "  95%" << quantile(0.95) << endl;
+    stream << setw(14) << "  max" << quantile(1) << endl;
+    stream << setw(14) << "  uncovered" << uncovered << " columns" << endl;
+
+    //Compare the columns near an edge with the rest, near means within about
+    //one expected run length.
+    double expected_run = report.runs == 0 ? 0 : report.run_length_sum / report.runs;
+    vector<uint64_t> edge;
+    vector<uint64_t> interior;
+    for(const Partition& region : report.regions){
+        size_t window = max<size_t>(1, min<size_t>(ceil(expected_run),
+                                                   region.width() / 4));
+        for(size_t column = region.start; column < region.end; column++){
+            if(column - region.start < window || region.end - column <= window){
+                edge.push_back(report.coverage[column]);
+            }
+            else{
+                interior.push_back(report.coverage[column]);
+            }
+        }
+    }
+    double edge_mean, edge_deviation, interior_mean, interior_deviation;
+    MeanAndDeviation(edge, edge_mean, edge_deviation);
+    MeanAndDeviation(interior, interior_mean, interior_deviation);
+    stream << endl << "edge effects (columns within one mean run length of a"
+              " region edge):" << endl;
+    stream << setw(14) << "  edge mean" << edge_mean << " over " << edge.size()
+           << " columns" << endl;
+    stream << setw(14) << "  interior" << interior_mean << " over "
+           << interior.size() << " columns" << endl;
+    stream << setw(14) << "  ratio"
+           << (interior_mean == 0 ? 0.0 : edge_mean / interior_mean) << endl;
+
+    //And how long the walks ran before turning around
+    double run_mean = report.runs == 0 ? 0 : report.run_length_sum / report.runs;
+    double run_variance = report.runs == 0 ? 0 :
+        report.run_length_sum_squares / report.runs - run_mean * run_mean;
+    stream << endl << "runs between turnarounds:" << endl;
+    stream << setw(14) << "  count" << report.runs << " ("
+           << (report.walks == 0 ? 0.0 : double(report.runs) / report.walks)
+           << " per walk)" << endl;
+    stream << setw(14) << "  mean length" << run_mean << endl;
+    stream << setw(14) << "  sd" << sqrt(max(0.0, run_variance)) << endl;
+    stream << setw(14) << "  longest" << report.longest_run << endl;
+    stream << setw(14) << "  clipped"
+           << (report.runs == 0 ? 0.0 : 100.0 * report.clipped_runs / report.runs)
+           << "% ran into an edge" << endl;
+    stream << "  length histogram:" << endl;
+    for(size_t b = 0; b < report.run_length_buckets.size(); b++){
+        if(report.run_length_buckets[b] == 0){
+            continue;
+        }
+        stream << "    [" << (uint64_t(1) << b) << ", " << (uint64_t(1) << (b + 1))
+               << ")\t" << report.run_length_buckets[b] << endl;
+    }
+
+    return stream;
+}
@@ -0,0 +1,56 @@
+/* Coverage diagnostics, for judging a choice of bias and length before
+ * producing any replicates. Walks are drawn exactly as they would be for a
+ * real run but never applied to the alignment. Instead each thread adds its
+ * walks' segments to a difference array over the original columns (+1 where a
+ * segment starts, -1 just past where it ends), so a walk costs time
+ * proportional to its number of segments rather than its length. The arrays
+ * are summed once at the end to get the number of times every column was
+ * copied into a replicate.
+ */
+
+#pragma once
+
+#include "partition.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <ostream>
+
+struct CoverageConfig{
+    uint64_t seed = 0;          //Walks are the ones a run with this seed draws
+    size_t first = 1;           //Number of the first replicate's walk
+    size_t number = 1;          //How many walks to draw
+    size_t length = 0;          //Length of each walk
+    double bias = 0.01;
+    size_t threads = 1;
+    std::vector<Partition> partitions;  //If not empty, walk each separately
+};
+
+struct CoverageReport{
+    //How many times each original column was visited, over all walks
+    std::vector<uint64_t> coverage;
+
+    //Where the walks were allowed to go, the whole input or each partition
+    std::vector<Partition> regions;
+    size_t walks = 0;
+    size_t walk_length = 0;
+
+    //Runs between turnarounds. A run is clipped if it ran into the edge of
+    //its region, rather than turning around by chance or ending the walk.
+    uint64_t runs = 0;
+    uint64_t clipped_runs = 0;
+    double run_length_sum = 0;
+    double run_length_sum_squares = 0;
+    uint64_t longest_run = 0;
+    std::vector<uint64_t> run_length_buckets;  //Bucket i holds [2^i, 2^(i+1))
+};
+
+//Draw the walks on a pool of threads and tally their coverage. Every walk comes
+//from its replicate's own rng (see ReplicateRNG), so the result doesn't depend
+//on the number of threads and covers exactly the walks a real run would use.
+CoverageReport ComputeCoverage(const CoverageConfig&, size_t input_length);
+
+//A human readable summary of the coverage distribution, the coverage near
+//region edges compared to the interior, and the run lengths.
+std::ostream& operator<<(std::ostream&, const CoverageReport&);
@@ -0,0 +1,358 @@
+#include "fai.hpp"
+#include "sequence.hpp"
+#include "binary.hpp"
+#include "kernels.hpp"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+using std::memcpy; using std::memcmp; using std::strerror;
+#include <algorithm>
+using std::min;
+#include <stdexcept>
+using std::runtime_error;
+#include <fstream>
+using std::ifstream; using std::ofstream;
+#include <istream>
+using std::istream;
+#include <ostream>
+using std::ostream;
+#include <string>
+using std::string; using std::to_string; using std::getline;
+#include <unordered_map>
+using std::unordered_map;
+#include <vector>
+using std::vector;
+
+FASTAIndex BuildFASTAIndex(const string& path){
+    int fd = open(path.c_str(), O_RDONLY);
+    if(fd < 0){
+        throw runtime_error("Could not open \"" + path + "\"");
+    }
+    struct stat info;
+    if(fstat(fd, &info) != 0){
+        close(fd);
+        throw runtime_error("Could not read \"" + path + "\"");
+    }
+    size_t size = info.st_size;
+    FASTAIndex index;
+    if(size == 0){
+        close(fd);
+        return index;
+    }
+    void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(mapping == MAP_FAILED){
+        throw runtime_error("Could not map \"" + path + "\"");
+    }
+    madvise(mapping, size, MADV_SEQUENTIAL);
+    const char* base = static_cast<const char*>(mapping);
+    const char* end = base + size;
+
+    //A record's lines must all be full until one is short or blank, after
+    //that only blank lines may come before the next header
+    bool ended = false;
+    string error;
+    for(const char* line = base; line < end && error.empty(); ){
+        const char* newline = FindByte(line, end, '\n');
+        size_t bases = newline - line;
+        if(bases == 0){
+            ended = !index.empty() && index.back().length > 0;
+        }
+        else if(*line == '>'){
+            FASTARecord record{string(line + 1, newline), 0,
+                               uint64_t(newline + 1 - base), 0, 0};
+            index.push_back(record);
+            ended = false;
+        }
+        else if(index.empty()){
+            error = "\"" + path + "\" is not a FASTA file";
+        }
+        else{
+            FASTARecord& record = index.back();
+            if(record.length == 0){
+                record.offset = line - base;
+                record.line_bases = bases;
+                record.line_bytes = bases + 1;
+            }
+            else if(ended || bases > record.line_bases){
+                error = "The lines of \"" + record.name + "\" in \"" + path +
+                        "\" are not all the same length, so it can't be indexed";
+            }
+            ended = bases < record.line_bases;
+            record.length += bases;
+        }
+        line = newline + 1;
+    }
+    munmap(mapping, size);
+    if(!error.empty()){
+        throw runtime_error(error);
+    }
+    return index;
+}
+
+void WriteFASTAIndex(ostream& stream, const FASTAIndex& index){
+    for(const FASTARecord& record : index){
+        stream << record.name << '\t' << record.length << '\t' << record.offset
+               << '\t' << record.line_bases << '\t' << record.line_bytes << '\n';
+    }
+}
+
+FASTAIndex ReadFASTAIndex(istream& stream){
+    FASTAIndex index;
+    string line;
+    while(getline(stream, line)){
+        if(line.empty()){
+            continue;
+        }
+
+        //Names may hold tabs themselves, so the numbers are taken from the end
+        uint64_t fields[4];
+        size_t field_end = line.size();
+        for(int i = 3; i >= 0; i--){
+            size_t tab = field_end == 0 ? string::npos :
+                         line.rfind('\t', field_end - 1);
+            if(tab == string::npos){
+                throw runtime_error("Bad FASTA index line \"" + line + "\"");
+            }
+            try{
+                fields[i] = std::stoull(line.substr(tab + 1, field_end - tab - 1));
+            }
+            catch (std::logic_error& e){
+                throw runtime_error("Bad FASTA index line \"" + line + "\"");
+            }
+            field_end = tab;
+        }
+        FASTARecord record{line.substr(0, field_end), fields[0], fields[1],
+                           fields[2], fields[3]};
+        index.push_back(record);
+    }
+    return index;
+}
+
+//Where column col of a record is in the file
+static uint64_t ColumnOffset(const FASTARecord& record, uint64_t col){
+    return record.offset + (col / record.line_bases) * record.line_bytes +
+           col % record.line_bases;
+}
+
+//True if the file at path was modified after the one at other_path, or either
+//doesn't exist
+static bool NewerThan(const string& path, const string& other_path){
+    struct stat info, other_info;
+    if(stat(path.c_str(), &info) != 0 || stat(other_path.c_str(), &other_info) != 0){
+        return true;
+    }
+    if(info.st_mtim.tv_sec != other_info.st_mtim.tv_sec){
+        return info.st_mtim.tv_sec > other_info.st_mtim.tv_sec;
+    }
+    return info.st_mtim.tv_nsec > other_info.st_mtim.tv_nsec;
+}
+
+FASTAIndex LoadFASTAIndex(const string& path){
+    string index_path = path + FASTA_INDEX_EXTENSION;
+    struct stat info;
+    if(stat(path.c_str(), &info) != 0){
+        throw runtime_error("Could not open \"" + path + "\"");
+    }
+
+    //An index which is up to date is used as long as it fits in the file
+    if(!NewerThan(path, index_path)){
+        ifstream index_file(index_path);
+        FASTAIndex index;
+        bool valid = index_file.is_open();
+        try{
+            index = ReadFASTAIndex(index_file);
+        }
+        catch (std::runtime_error& e){
+            valid = false;
+        }
+        for(const FASTARecord& record : index){
+            if(record.length > 0 && (record.line_bases == 0 ||
+               record.line_bytes <= record.line_bases ||
+               ColumnOffset(record, record.length - 1) >= uint64_t(info.st_size))){
+                valid = false;
+            }
+        }
+        if(valid){
+            return index;
+        }
+    }
+
+    //Otherwise build it, and replace the old one in a single step so that
+    //another process never sees half of it
+    FASTAIndex index = BuildFASTAIndex(path);
+    string temporary_path = index_path + ".tmp" + to_string(getpid());
+    ofstream index_file(temporary_path);
+    WriteFASTAIndex(index_file, index);
+    index_file.close();
+    if(!index_file || rename(temporary_path.c_str(), index_path.c_str()) != 0){
+        std::remove(temporary_path.c_str());
+    }
+    return index;
+}
+
+//The positions of the selected taxa among all of them, in the order asked for
+static vector<size_t> SelectTaxa(const vector<string>& names,
+                                 const vector<string>& selected){
+    vector<size_t> rows;
+    if(selected.empty()){
+        for(size_t i = 0; i < names.size(); i++){
+            rows.push_back(i);
+        }
+        return rows;
+    }
+
+    //If a name appears twice, the first one is used as a taxon
+    unordered_map<string, size_t> positions;
+    for(size_t i = names.size(); i-- > 0; ){
+        positions[names[i]] = i;
+    }
+    unordered_map<string, bool> seen;
+    for(const string& name : selected){
+        auto found = positions.find(name);
+        if(found == positions.end()){
+            throw runtime_error("There is no taxon named \"" + name + "\"");
+        }
+        if(seen[name]){
+            throw runtime_error("The taxon \"" + name + "\" is selected twice");
+        }
+        seen[name] = true;
+        rows.push_back(found->second);
+    }
+    return rows;
+}
+
+//Check the columns fit in an alignment of the given length, and fill in the
+//end if it was left open
+static void CheckColumns(size_t length, size_t& start, size_t& end){
+    if(end == SIZE_MAX){
+        end = length;
+    }
+    if(start >= end || end > length){
+        throw runtime_error("The columns " + to_string(start) + ":" +
+                            to_string(end) + " are not within the alignment,"
+                            " which is " + to_string(length) + " long");
+    }
+}
+
+//Read size bytes at offset, throwing if the file ends first
+static void ReadAt(int fd, char* to, size_t size, uint64_t offset,
+                   const string& path){
+    while(size > 0){
+        ssize_t result = pread(fd, to, size, offset);
+        if(result < 0 && errno == EINTR){
+            continue;
+        }
+        if(result < 0){
+            throw runtime_error("Could not read \"" + path + "\": " +
+                                strerror(errno));
+        }
+        if(result == 0){
+            throw runtime_error("\"" + path + "\" is shorter than its index says");
+        }
+        to += result;
+        size -= result;
+        offset += result;
+    }
+}
+
+static void ReadIndexedFASTA(const string& path, const AlignmentSubset& subset,
+                             CharMatrix& matrix, vector<string>& taxa){
+    FASTAIndex index = LoadFASTAIndex(path);
+
+    //As with ReadFASTA, every record has to be the same non-zero length
+    for(const FASTARecord& record : index){
+        if(record.length == 0 || record.length != index[0].length){
+            throw runtime_error("FASTA file not an alignment");
+        }
+    }
+    if(index.empty()){
+        throw runtime_error("FASTA file not an alignment");
+    }
+    size_t start = subset.start, end = subset.end;
+    CheckColumns(index[0].length, start, end);
+    vector<string> names;
+    for(const FASTARecord& record : index){
+        names.push_back(record.name);
+    }
+    vector<size_t> rows = SelectTaxa(names, subset.taxa);
+
+    int fd = open(path.c_str(), O_RDONLY);
+    if(fd < 0){
+        throw runtime_error("Could not open \"" + path + "\"");
+    }
+
+    //Each row's columns are one byte range. If no newline falls inside it, it
+    //is read straight into the matrix, otherwise the lines are copied out.
+    CharMatrix result(rows.size(), end - start);
+    taxa.clear();
+    string buffer;
+    try{
+        for(size_t i = 0; i < rows.size(); i++){
+            const FASTARecord& record = index[rows[i]];
+            taxa.push_back(record.name);
+            uint64_t first = ColumnOffset(record, start);
+            uint64_t span = ColumnOffset(record, end - 1) + 1 - first;
+            char* to = result.row(i);
+            if(span == end - start){
+                ReadAt(fd, to, span, first, path);
+                continue;
+            }
+            buffer.resize(span);
+            ReadAt(fd, &buffer[0], span, first, path);
+            const char* from = buffer.data();
+            for(size_t col = start; col < end; ){
+                size_t bases = min<size_t>(record.line_bases -
+                                           col % record.line_bases, end - col);
+                memcpy(to, from, bases);
+                to += bases;
+                col += bases;
+                from += bases + record.line_bytes - record.line_bases;
+            }
+        }
+    }
+    catch (...){
+        close(fd);
+        throw;
+    }
+    close(fd);
+    swap(matrix, result);
+}
+
+void ReadAlignmentSubset(const string& path, const AlignmentSubset& subset,
+                         CharMatrix& matrix, vector<string>& taxa){
+    ifstream file(path, std::ios::binary);
+    if(!file.is_open()){
+        throw runtime_error("Could not open \"" + path + "\"");
+    }
+    char magic[sizeof(BINARY_MAGIC)] = {0};
+    file.read(magic, sizeof(magic));
+    bool binary = file.gcount() == sizeof(magic) &&
+                  memcmp(magic, BINARY_MAGIC, sizeof(BINARY_MAGIC)) == 0;
+    file.close();
+    if(!binary){
+        ReadIndexedFASTA(path, subset, matrix, taxa);
+        return;
+    }
+
+    //Only the pages of a row-major mapping that are copied from get read
+    CharMatrix whole;
+    vector<string> names;
+    ReadBinaryAlignment(path, whole, names);
+    size_t start = subset.start, end = subset.end;
+    CheckColumns(whole.length(), start, end);
+    vector<size_t> rows = SelectTaxa(names, subset.taxa);
+    CharMatrix result(rows.size(), end - start);
+    taxa.clear();
+    for(size_t i = 0; i < rows.size(); i++){
+        memcpy(result.row(i), whole.row(rows[i]) + start, end - start);
+        taxa.push_back(names[rows[i]]);
+    }
+    swap(matrix, result);
+}
@@ -0,0 +1,78 @@
+/* Random access into FASTA alignments through a .fai style index, so that a
+ * window of columns or a subset of taxa can be loaded from a very large
+ * alignment without parsing the rest of it. The index has a line per record,
+ * tab separated, as samtools writes them:
+ *
+ *     NAME    LENGTH    OFFSET    LINE_BASES    LINE_BYTES
+ *
+ * where OFFSET is where the record's first sequence character is in the file,
+ * and every line of the sequence but the last holds LINE_BASES characters in
+ * LINE_BYTES bytes. Any character in column c of a record is then found at
+ *
+ *     OFFSET + (c / LINE_BASES) * LINE_BYTES + c % LINE_BASES
+ *
+ * so a window of columns is one contiguous byte range per record, which is
+ * read with pread. Unlike samtools, NAME is the whole header line, as
+ * ReadFASTA names taxa.
+ *
+ * Since samtools' NAME is only the header's first word, the two indexes aren't
+ * interchangeable, so the index for alignment.fasta is kept apart from any
+ * samtools one, in alignment.fasta.sfai. It is built the first time it is
+ * needed, with one scan over the file, and rebuilt whenever the alignment is
+ * newer than it.
+ */
+
+#pragma once
+
+#include "sequence.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <istream>
+#include <ostream>
+
+//One record of a FASTA file
+struct FASTARecord{
+    std::string name;
+    uint64_t length;        //Sequence characters in the record
+    uint64_t offset;        //Of the first sequence character in the file
+    uint64_t line_bases;    //Sequence characters on every full line
+    uint64_t line_bytes;    //The same plus the newline
+};
+
+typedef std::vector<FASTARecord> FASTAIndex;
+
+//Appended to a FASTA file's path to give its index's
+const char FASTA_INDEX_EXTENSION[] = ".sfai";
+
+//Scan a FASTA file and index it. Throws std::runtime_error if the file can't
+//be read, or a record's lines aren't all the same length but its last, which
+//would stop its columns being found by arithmetic.
+FASTAIndex BuildFASTAIndex(const std::string& path);
+
+//Write an index in the .fai format, or read one back. Reading throws
+//std::runtime_error if a line isn't a valid index entry.
+void WriteFASTAIndex(std::ostream&, const FASTAIndex&);
+FASTAIndex ReadFASTAIndex(std::istream&);
+
+//The index of the FASTA file at path, read from path.sfai if that is up to
+//date, or else built and saved there. Failing to save it isn't an error, the
+//index just gets built again next time.
+FASTAIndex LoadFASTAIndex(const std::string& path);
+
+//Which part of an alignment to load
+struct AlignmentSubset{
+    size_t start = 0;               //First column, 0 based
+    size_t end = SIZE_MAX;          //One past the last column, or to the end
+    std::vector<std::string> taxa;  //In this order, or every taxon if empty
+};
+
+//Load only the given columns and taxa of an alignment. FASTA files are read
+//through their index, binary alignments are mapped and only the selected rows
+//and columns are copied out. Throws std::runtime_error if the file isn't an
+//alignment, a taxon isn't in it or is asked for twice, or the columns aren't
+//within it.
+void ReadAlignmentSubset(const std::string& path, const AlignmentSubset&,
+                         CharMatrix&, std::vector<std::string>&);
@@ -0,0 +1,169 @@
+#include "grid.hpp"
+#include "sequence.hpp"
+#include "walk.hpp"
+#include "resample.hpp"
+#include "pipeline.hpp"
+#include "threadpool.hpp"
+#include "binary.hpp"
+#include "dedup.hpp"
+
+#include <sys/stat.h>
+#include <cerrno>
+
+#include <chrono>
+#include <mutex>
+using std::mutex; using std::lock_guard;
+#include <set>
+using std::set;
+#include <stdexcept>
+using std::runtime_error;
+#include <sstream>
+using std::ostringstream;
+#include <iomanip>
+using std::fixed; using std::setprecision;
+#include <ostream>
+using std::ostream; using std::endl;
+#include <string>
+using std::string; using std::to_string;
+#include <vector>
+using std::vector;
+
+typedef std::chrono::steady_clock Clock;
+
+string GridPointName(double bias, size_t length){
+    ostringstream name;
+    name << "b" << bias << "-l" << length;
+    return name.str();
+}
+
+//State shared by every task in a grid run. Each grid point is described by the
+//pipeline config a single run at that point would use.
+struct GridState{
+    const CharMatrix& source;           //The input's unique rows
+    const vector<size_t>* rows;         //Maps them back out, if collapsed
+    const vector<string>& taxa;
+    size_t input_length;
+    vector<PipelineConfig> points;
+
+    mutex stats_mutex;                  //Guards everything below
+    GridStats stats;
+    set<size_t> failed;
+    ostream& errors;
+
+    GridState(const CharMatrix& s, const vector<size_t>* r,
+              const vector<string>& t, size_t l, ostream& e):
+        source(s), rows(r), taxa(t), input_length(l), errors(e){};
+
+    //Only a grid point's first error is reported, the rest are likely the same
+    void fail(size_t point, const string& message){
+        lock_guard<mutex> lock(stats_mutex);
+        if(failed.insert(point).second){
+            errors << "Error! Grid point \"" << points[point].directory
+                   << "\": " << message << endl;
+        }
+    }
+};
+
+//Draw, resample and write a single replicate of a grid point. The matrix and
+//text buffers belong to the thread and are reused by every task it runs.
+static void GridTask(GridState& state, size_t point, size_t trial_num){
+    Clock::time_point start = Clock::now();
+    const PipelineConfig& config = state.points[point];
+    thread_local CharMatrix matrix;
+    thread_local string alignment;
+    try{
+        RandomWalk walk = DrawReplicateWalk(config, state.input_length, trial_num);
+        Resample(state.source, walk, matrix);
+        FormatAlignment(config.format, alignment, matrix, state.taxa, state.rows);
+        ostringstream walk_text;
+        walk_text << walk << '\n';
+        WriteReplicateFiles(ReplicatePrefix(config, trial_num), config.format,
+                            alignment, walk_text.str());
+    }
+    catch(std::exception& e){
+        state.fail(point, e.what());
+    }
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    lock_guard<mutex> lock(state.stats_mutex);
+    state.stats.busy_seconds += seconds;
+    state.stats.replicates++;
+}
+
+GridStats RunGrid(const GridConfig& config, const CharMatrix& input_sequence,
+                  const vector<string>& taxa, ostream& errors, size_t& failures){
+    Clock::time_point start = Clock::now();
+
+    //Identical rows are only resampled once, as in the pipeline
+    CharMatrix unique;
+    vector<size_t> row_map;
+    bool collapsed = DeduplicateRows(input_sequence, unique, row_map);
+    GridState state(collapsed ? unique : input_sequence,
+                    collapsed ? &row_map : nullptr, taxa,
+                    input_sequence.length(), errors);
+
+    //Two grid points with the same name would overwrite each other's files
+    set<string> names;
+    for(double bias : config.biases){
+        for(size_t length : config.lengths){
+            PipelineConfig point;
+            point.seed = config.seed;
+            point.first = config.first;
+            point.number = config.number;
+            point.length = length;
+            point.bias = bias;
+            point.partitions = config.partitions;
+            point.format = config.format;
+            point.directory = GridPointName(bias, length);
+            if(!names.insert(point.directory).second){
+                throw runtime_error("More than one grid point is named \"" +
+                                    point.directory + "\"");
+            }
+            state.points.push_back(point);
+        }
+    }
+    for(size_t i = 0; i < state.points.size(); i++){
+        const string& directory = state.points[i].directory;
+        if(mkdir(directory.c_str(), 0755) != 0 && errno != EEXIST){
+            state.fail(i, "could not create the directory \"" + directory + "\"");
+        }
+    }
+
+    //Replicates are handed out across the grid points, so they all progress
+    //together and a slow point doesn't leave the pool idle at the end
+    set<size_t> unwritable = state.failed;
+    ThreadPool pool(config.threads);
+    size_t last = config.first + config.number;
+    for(size_t trial_num = config.first; trial_num < last; trial_num++){
+        for(size_t i = 0; i < state.points.size(); i++){
+            if(unwritable.count(i) != 0){
+                continue;
+            }
+            GridState* state_ptr = &state;
+            pool.submit([state_ptr, i, trial_num]{
+                GridTask(*state_ptr, i, trial_num);
+            });
+        }
+    }
+    pool.wait();
+
+    failures = state.failed.size();
+    state.stats.points = state.points.size();
+    state.stats.threads = pool.size();
+    state.stats.wall_seconds =
+        std::chrono::duration<double>(Clock::now() - start).count();
+    return state.stats;
+}
+
+ostream& operator<<(ostream& stream, const GridStats& stats){
+    stream << "grid points: " << stats.points << ", replicates: "
+           << stats.replicates << endl;
+    stream << fixed << setprecision(3) << "wall time: " << stats.wall_seconds
+           << "s, resampling and writing: " << stats.busy_seconds << "s";
+    if(stats.wall_seconds > 0 && stats.threads > 0){
+        stream << setprecision(1) << " (" << 100 * stats.busy_seconds /
+               (stats.wall_seconds * stats.threads) << "% of " << stats.threads
+               << " threads)";
+    }
+    stream << endl;
+    return stream;
+}
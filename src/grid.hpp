@@ -0,0 +1,60 @@
+/* Grid mode resamples one alignment at every combination of several biases and
+ * lengths, for studying how the parameters affect support. The input is read
+ * and deduplicated once, and every (bias, length, replicate) becomes a task on
+ * a work stealing thread pool, all sharing the one input matrix. Each thread
+ * reuses its own matrix and text buffers from task to task, so almost all of
+ * the run's time goes into resampling and writing.
+ *
+ * Each grid point's replicates go in their own subdirectory of the working
+ * directory, named like b0.01-l5000. Replicate N of a grid point is drawn from
+ * ReplicateRNG(seed, N), exactly as by a single seres-resample run with that
+ * bias and length, so every subdirectory holds the same files such a run would
+ * write, apart from the manifest.
+ */
+
+#pragma once
+
+#include "sequence.hpp"
+#include "partition.hpp"
+#include "binary.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <ostream>
+
+struct GridConfig{
+    uint64_t seed = 0;
+    size_t first = 1;               //Number of each grid point's first replicate
+    size_t number = 1;              //Replicates per grid point
+    std::vector<double> biases;
+    std::vector<size_t> lengths;
+    std::vector<Partition> partitions;  //If not empty, walk each separately
+    size_t threads = 1;
+    AlignmentFormat format = AlignmentFormat::FASTA;  //Of the replicates
+};
+
+//How a grid run went. Busy time is summed over the tasks, so with the pool
+//kept full it comes close to threads times the wall time.
+struct GridStats{
+    size_t points = 0;
+    size_t replicates = 0;
+    size_t threads = 0;
+    double wall_seconds = 0;
+    double busy_seconds = 0;
+};
+
+std::ostream& operator<<(std::ostream&, const GridStats&);
+
+//The subdirectory used for a grid point, bias 0.01 and length 5000 ->
+//"b0.01-l5000"
+std::string GridPointName(double bias, size_t length);
+
+//Resample the input at every grid point. Grid points whose directory or files
+//can't be written are reported to the errors stream, and the number of them
+//is returned in failures. Throws std::runtime_error up front if two grid
+//points would share a directory.
+GridStats RunGrid(const GridConfig&, const CharMatrix& input_sequence,
+                  const std::vector<std::string>& taxa, std::ostream& errors,
+                  size_t& failures);
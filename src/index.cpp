@@ -0,0 +1,193 @@
+#include "index.hpp"
+#include "walk.hpp"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstring>
+using std::memcpy; using std::memcmp;
+#include <algorithm>
+using std::max;
+#include <stdexcept>
+using std::runtime_error;
+#include <fstream>
+using std::ofstream;
+#include <string>
+using std::string;
+#include <utility>
+using std::swap;
+#include <vector>
+using std::vector;
+
+InverseIndex::~InverseIndex(){
+    if(mapped_){
+        munmap(const_cast<char*>(data_), size_);
+    }
+}
+
+InverseIndex::InverseIndex(InverseIndex&& other): InverseIndex(){
+    *this = std::move(other);
+}
+
+InverseIndex& InverseIndex::operator=(InverseIndex&& other){
+    swap(owned_, other.owned_);
+    swap(data_, other.data_);
+    swap(size_, other.size_);
+    swap(mapped_, other.mapped_);
+    return *this;
+}
+
+//First and last original column covered by a segment
+static void SegmentColumns(const WalkSegment& ws, size_t& low, size_t& high){
+    if(ws.direction == Direction::Right){
+        low = ws.original_pos;
+        high = ws.original_pos + ws.length - 1;
+    }
+    else{
+        low = ws.original_pos - ws.length + 1;
+        high = ws.original_pos;
+    }
+}
+
+InverseIndex InverseIndex::Build(const vector<RandomWalk>& walks,
+                                 size_t original_length){
+
+    //Find the extent of the original if we weren't told, and make sure
+    //everything fits in the entries.
+    size_t furthest = 0;
+    for(const RandomWalk& walk : walks){
+        if(walk.length() > UINT32_MAX){
+            throw runtime_error("Walks longer than 2^32 sites can't be indexed");
+        }
+        for(const WalkSegment& ws : walk){
+            size_t low, high;
+            SegmentColumns(ws, low, high);
+            furthest = max(furthest, high + 1);
+        }
+    }
+    if(walks.size() > UINT32_MAX){
+        throw runtime_error("More than 2^32 walks can't be indexed");
+    }
+    if(original_length == 0){
+        original_length = furthest;
+    }
+    if(furthest > original_length){
+        throw runtime_error("A walk visits a column past the end of the original");
+    }
+
+    //Pass 1, count visits to each column with a difference array
+    vector<uint64_t> counts(original_length + 1, 0);
+    for(const RandomWalk& walk : walks){
+        for(const WalkSegment& ws : walk){
+            size_t low, high;
+            SegmentColumns(ws, low, high);
+            counts[low]++;
+            counts[high + 1]--;
+        }
+    }
+    uint64_t running = 0;
+    for(size_t column = 0; column < original_length; column++){
+        running += counts[column];
+        counts[column] = running;
+    }
+
+    //Lay out the index and turn the counts into offsets
+    uint64_t entry_count = 0;
+    for(size_t column = 0; column < original_length; column++){
+        entry_count += counts[column];
+    }
+    InverseIndex result;
+    result.size_ = sizeof(IndexHeader) + (original_length + 1) * sizeof(uint64_t) +
+                   entry_count * sizeof(IndexEntry);
+    result.owned_.resize(result.size_);
+    result.data_ = result.owned_.data();
+
+    IndexHeader header;
+    memcpy(header.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC));
+    header.version = INDEX_VERSION;
+    header.reserved = 0;
+    header.original_length = original_length;
+    header.walk_count = walks.size();
+    header.entry_count = entry_count;
+    memcpy(result.owned_.data(), &header, sizeof(IndexHeader));
+
+    uint64_t* offsets = reinterpret_cast<uint64_t*>(
+        result.owned_.data() + sizeof(IndexHeader));
+    uint64_t total = 0;
+    for(size_t column = 0; column < original_length; column++){
+        offsets[column] = total;
+        total += counts[column];
+    }
+    offsets[original_length] = total;
+
+    //Pass 2, drop every replicate position into its column's next free slot.
+    //Walks and positions are visited in order, so each column's entries come
+    //out sorted without any further work.
+    vector<uint64_t> cursor(offsets, offsets + original_length);
+    IndexEntry* entries = const_cast<IndexEntry*>(result.entries());
+    for(size_t w = 0; w < walks.size(); w++){
+        for(const WalkSegment& ws : walks[w]){
+            size_t column = ws.original_pos;
+            for(size_t i = 0; i < ws.length; i++){
+                IndexEntry& entry = entries[cursor[column]++];
+                entry.walk = w;
+                entry.replicate_pos = ws.replicate_pos + i;
+                if(ws.direction == Direction::Right){
+                    column++;
+                }
+                else{
+                    column--;
+                }
+            }
+        }
+    }
+
+    return result;
+}
+
+InverseIndex InverseIndex::Map(const string& path){
+    int fd = open(path.c_str(), O_RDONLY);
+    if(fd < 0){
+        throw runtime_error("Could not open the index \"" + path + "\"");
+    }
+    struct stat info;
+    if(fstat(fd, &info) != 0 || size_t(info.st_size) < sizeof(IndexHeader)){
+        close(fd);
+        throw runtime_error("\"" + path + "\" is not an index");
+    }
+    void* mapped = mmap(nullptr, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if(mapped == MAP_FAILED){
+        throw runtime_error("Could not map the index \"" + path + "\"");
+    }
+
+    InverseIndex result;
+    result.data_ = static_cast<const char*>(mapped);
+    result.size_ = info.st_size;
+    result.mapped_ = true;
+
+    //Check the header and that the sections fit in the file
+    const IndexHeader* header = result.header();
+    size_t expected = sizeof(IndexHeader) +
+                      (header->original_length + 1) * sizeof(uint64_t) +
+                      header->entry_count * sizeof(IndexEntry);
+    if(memcmp(header->magic, INDEX_MAGIC, sizeof(INDEX_MAGIC)) != 0 ||
+       header->version != INDEX_VERSION || expected != result.size_){
+        throw runtime_error("\"" + path + "\" is not an index");
+    }
+    return result;
+}
+
+void InverseIndex::save(const string& path) const{
+    ofstream file(path, std::ios::binary);
+    if(!file.is_open()){
+        throw runtime_error("Could not open \"" + path + "\" for writing");
+    }
+    file.write(data_, size_);
+    if(!file){
+        throw runtime_error("Could not write to \"" + path + "\"");
+    }
+}
@@ -0,0 +1,105 @@
+/* An inverse index over one or many walks, answering "where did original
+ * column X end up in each replicate". It is the transpose of the walks: for
+ * every original column, the list of (walk, replicate position) pairs which
+ * were copied from it, ordered by walk and then by position.
+ *
+ * The index is built with a counting sort over the walk segments. A first pass
+ * counts how often each column is visited using a difference array over the
+ * segments, prefix sums turn those counts into offsets, and a second pass drops
+ * every replicate position straight into its slot.
+ *
+ * The same layout is used in memory and on disk, so a saved index can be
+ * memory mapped and queried without any parsing:
+ *
+ *     IndexHeader
+ *     uint64_t offsets[original_length + 1]  column c owns entries
+ *                                            [offsets[c], offsets[c+1])
+ *     IndexEntry entries[entry_count]
+ *
+ * Integers are stored in native byte order.
+ */
+
+#pragma once
+
+#include "walk.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+const char INDEX_MAGIC[8] = {'S', 'E', 'R', 'E', 'S', 'I', 'D', 'X'};
+const uint32_t INDEX_VERSION = 1;
+
+struct IndexHeader{
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t original_length;
+    uint64_t walk_count;
+    uint64_t entry_count;
+};
+
+//One replicate position of an original column, walks are numbered from 0 in
+//the order they were given to the index.
+struct IndexEntry{
+    uint32_t walk;
+    uint32_t replicate_pos;
+};
+
+class InverseIndex{
+    private:
+        //Either owned memory or a read only mapping of a saved index
+        std::vector<char> owned_;
+        const char* data_ = nullptr;
+        size_t size_ = 0;
+        bool mapped_ = false;
+
+        const IndexHeader* header() const{
+            return reinterpret_cast<const IndexHeader*>(data_);
+        };
+        const uint64_t* offsets() const{
+            return reinterpret_cast<const uint64_t*>(data_ + sizeof(IndexHeader));
+        };
+        const IndexEntry* entries() const{
+            return reinterpret_cast<const IndexEntry*>(
+                data_ + sizeof(IndexHeader) +
+                (header()->original_length + 1) * sizeof(uint64_t));
+        };
+
+    public:
+
+        //Empty index, move only since a mapping can't be shared
+        InverseIndex() = default;
+        ~InverseIndex();
+        InverseIndex(InverseIndex&&);
+        InverseIndex& operator=(InverseIndex&&);
+        InverseIndex(const InverseIndex&) = delete;
+        InverseIndex& operator=(const InverseIndex&) = delete;
+
+        //Build an index over the walks. original_length may be 0, in which
+        //case it is taken from the furthest column any walk visits. Throws
+        //std::runtime_error if a walk visits a column past original_length or
+        //if the walks are too long to fit the 32 bit entries.
+        static InverseIndex Build(const std::vector<RandomWalk>&,
+                                  size_t original_length = 0);
+
+        //Map a saved index read only. Throws std::runtime_error if the file
+        //can't be mapped or isn't an index.
+        static InverseIndex Map(const std::string& path);
+
+        //Write the index to a file, throws std::runtime_error on failure
+        void save(const std::string& path) const;
+
+        size_t original_length() const{return header()->original_length;};
+        size_t walk_count() const{return header()->walk_count;};
+        size_t entry_count() const{return header()->entry_count;};
+
+        //Every replicate position of an original column. Not bounds checked.
+        const IndexEntry* begin(size_t column) const{
+            return entries() + offsets()[column];
+        };
+        const IndexEntry* end(size_t column) const{
+            return entries() + offsets()[column + 1];
+        };
+};
@@ -0,0 +1,74 @@
+//The AVX2 kernels. This file is compiled for AVX2 and is only called after
+//ActiveKernelSet() has checked the CPU supports it, see kernels-impl.hpp.
+
+#if defined(__x86_64__)
+
+#pragma GCC target("avx2")
+
+#include "kernels-impl.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace{
+
+struct AVX2Ops{
+    typedef __m256i Vector;
+    enum{WIDTH = 32};
+
+    static Vector load(const char* p){
+        return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    }
+    static void store(char* p, Vector v){
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), v);
+    }
+    static Vector broadcast(char c){return _mm256_set1_epi8(c);}
+    static uint64_t equal_mask(Vector a, Vector b){
+        return uint32_t(_mm256_movemask_epi8(_mm256_cmpeq_epi8(a, b)));
+    }
+
+    //Reverse each lane with a byte shuffle, then swap the lanes
+    static Vector reverse(Vector v){
+        const __m256i order = _mm256_setr_epi8(
+            15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0,
+            15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+        v = _mm256_shuffle_epi8(v, order);
+        return _mm256_permute2x128_si256(v, v, 1);
+    }
+
+    static Vector unpack_lo8(Vector a, Vector b){return _mm256_unpacklo_epi8(a, b);}
+    static Vector unpack_hi8(Vector a, Vector b){return _mm256_unpackhi_epi8(a, b);}
+    static Vector unpack_lo16(Vector a, Vector b){return _mm256_unpacklo_epi16(a, b);}
+    static Vector unpack_hi16(Vector a, Vector b){return _mm256_unpackhi_epi16(a, b);}
+    static Vector unpack_lo32(Vector a, Vector b){return _mm256_unpacklo_epi32(a, b);}
+    static Vector unpack_hi32(Vector a, Vector b){return _mm256_unpackhi_epi32(a, b);}
+    static Vector unpack_lo64(Vector a, Vector b){return _mm256_unpacklo_epi64(a, b);}
+    static Vector unpack_hi64(Vector a, Vector b){return _mm256_unpackhi_epi64(a, b);}
+    static void store_lanes(char* p, size_t lane_stride, Vector v){
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(p),
+                         _mm256_castsi256_si128(v));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(p + lane_stride),
+                         _mm256_extracti128_si256(v, 1));
+    }
+};
+
+}
+
+void ReverseCopyAVX2(char* to, const char* from, size_t size){
+    ReverseCopyWith<AVX2Ops>(to, from, size);
+}
+
+//Columns which don't fill a 32 byte block still get 16 byte ones
+void TransposeAVX2(const char* from, size_t from_stride, size_t height,
+                   size_t length, char* to, size_t to_stride){
+    size_t wide = length - length % AVX2Ops::WIDTH;
+    TransposeWith<AVX2Ops>(from, from_stride, height, wide, to, to_stride);
+    TransposeWith<SSE2Ops>(from + wide, from_stride, height, length - wide,
+                           to + wide * to_stride, to_stride);
+}
+
+const char* FindByteAVX2(const char* begin, const char* end, char c){
+    return FindByteWith<AVX2Ops>(begin, end, c);
+}
+
+#endif
@@ -0,0 +1,55 @@
+//The AVX-512 kernels, which only need the F and BW subsets. This file is
+//compiled for AVX-512 and is only called after ActiveKernelSet() has checked
+//the CPU supports it, see kernels-impl.hpp. There is no AVX-512 transpose, a
+//64 column block scatters its stores over 64 output rows and measured slower
+//than the AVX2 one on every shape tried.
+
+#if defined(__x86_64__)
+
+#pragma GCC target("avx2,avx512f,avx512bw")
+
+//GCC 12 warns about the deliberately undefined registers inside its own
+//AVX-512 headers once they are enabled this way
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+
+#include "kernels-impl.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace{
+
+struct AVX512Ops{
+    typedef __m512i Vector;
+    enum{WIDTH = 64};
+
+    static Vector load(const char* p){return _mm512_loadu_si512(p);}
+    static void store(char* p, Vector v){_mm512_storeu_si512(p, v);}
+    static Vector broadcast(char c){return _mm512_set1_epi8(c);}
+    static uint64_t equal_mask(Vector a, Vector b){
+        return _mm512_cmpeq_epi8_mask(a, b);
+    }
+
+    //Reverse each lane with a byte shuffle, then the order of the lanes.
+    //Reversing across the whole register at once would need VBMI.
+    static Vector reverse(Vector v){
+        const __m512i order = _mm512_broadcast_i32x4(_mm_setr_epi8(
+            15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0));
+        v = _mm512_shuffle_epi8(v, order);
+        return _mm512_shuffle_i64x2(v, v, _MM_SHUFFLE(0, 1, 2, 3));
+    }
+
+};
+
+}
+
+void ReverseCopyAVX512(char* to, const char* from, size_t size){
+    ReverseCopyWith<AVX512Ops>(to, from, size);
+}
+
+const char* FindByteAVX512(const char* begin, const char* end, char c){
+    return FindByteWith<AVX512Ops>(begin, end, c);
+}
+
+#endif
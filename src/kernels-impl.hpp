@@ -0,0 +1,186 @@
+/* The pieces shared by every implementation of the kernels in kernels.hpp. The
+ * loops are written once as templates over a set of vector operations, and
+ * each of kernels.cpp, kernels-avx2.cpp and kernels-avx512.cpp instantiates
+ * them with its own. Those files are compiled for different instruction sets,
+ * so everything here has internal linkage: a copy built for AVX2 must never be
+ * picked by the linker in place of another file's copy. For the same reason the
+ * vector files don't use the standard library.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+//Entry points of the vector files, only reached through ActiveKernelSet()
+void ReverseCopyAVX2(char* to, const char* from, size_t size);
+void TransposeAVX2(const char* from, size_t from_stride, size_t height,
+                   size_t length, char* to, size_t to_stride);
+const char* FindByteAVX2(const char* begin, const char* end, char c);
+void ReverseCopyAVX512(char* to, const char* from, size_t size);
+const char* FindByteAVX512(const char* begin, const char* end, char c);
+
+namespace{
+
+//Transposes one block at a time so that both matrices are walked through in
+//pieces which stay in cache, however far apart their rows are.
+inline void TransposeScalarBlocked(const char* from, size_t from_stride,
+                                   size_t height, size_t length, char* to,
+                                   size_t to_stride){
+    const size_t block = 32;
+    for(size_t row_start = 0; row_start < height; row_start += block){
+        size_t row_end = height - row_start < block ? height : row_start + block;
+        for(size_t col_start = 0; col_start < length; col_start += block){
+            size_t col_end = length - col_start < block ? length
+                                                        : col_start + block;
+            for(size_t col = col_start; col < col_end; col++){
+                for(size_t row = row_start; row < row_end; row++){
+                    to[col * to_stride + row] = from[row * from_stride + col];
+                }
+            }
+        }
+    }
+}
+
+#if defined(__x86_64__)
+
+//Ops are structs of static functions over one vector type:
+//    Vector, WIDTH           the register type and its size in bytes
+//    load, store             unaligned
+//    broadcast, equal_mask   bit i of the mask is set if byte i is equal
+//    reverse                 the bytes of the whole register back to front
+//    unpack_lo/hi8..64       the SSE2 unpacks, applied to each 16 byte lane
+//    store_lanes             lane i goes to p + i * lane_stride
+
+template<typename Ops>
+inline void ReverseCopyWith(char* to, const char* from, size_t size){
+    size_t done = 0;
+    for(; done + Ops::WIDTH <= size; done += Ops::WIDTH){
+        Ops::store(to + done,
+                   Ops::reverse(Ops::load(from + size - done - Ops::WIDTH)));
+    }
+    for(; done < size; done++){
+        to[done] = from[size - 1 - done];
+    }
+}
+
+template<typename Ops>
+inline const char* FindByteWith(const char* begin, const char* end, char c){
+    typename Ops::Vector target = Ops::broadcast(c);
+    for(; size_t(end - begin) >= Ops::WIDTH; begin += Ops::WIDTH){
+        uint64_t mask = Ops::equal_mask(Ops::load(begin), target);
+        if(mask != 0){
+            return begin + __builtin_ctzll(mask);
+        }
+    }
+    while(begin != end && *begin != c){
+        begin++;
+    }
+    return begin;
+}
+
+//Transposes 16 rows by WIDTH columns. Four rounds of unpacks interleave pairs
+//of rows, then pairs of those, and so on until each 16 byte lane of register k
+//holds column k of its lane's 16 columns.
+template<typename Ops>
+inline void TransposeBlock(const char* from, size_t from_stride, char* to,
+                           size_t to_stride){
+    typedef typename Ops::Vector Vector;
+    Vector rows[16], pairs[16], quads[16], octets[16];
+    for(int i = 0; i < 16; i++){
+        rows[i] = Ops::load(from + i * from_stride);
+    }
+
+    //Columns 8h..8h+7 of rows 2g and 2g+1, in pairs[2g + h]
+    for(int g = 0; g < 8; g++){
+        pairs[2 * g] = Ops::unpack_lo8(rows[2 * g], rows[2 * g + 1]);
+        pairs[2 * g + 1] = Ops::unpack_hi8(rows[2 * g], rows[2 * g + 1]);
+    }
+    //Columns 4m..4m+3 of rows 4q..4q+3, in quads[4q + m]
+    for(int q = 0; q < 4; q++){
+        for(int h = 0; h < 2; h++){
+            Vector first = pairs[4 * q + h], second = pairs[4 * q + 2 + h];
+            quads[4 * q + 2 * h] = Ops::unpack_lo16(first, second);
+            quads[4 * q + 2 * h + 1] = Ops::unpack_hi16(first, second);
+        }
+    }
+    //Columns 2n and 2n+1 of rows 8o..8o+7, in octets[8o + n]
+    for(int o = 0; o < 2; o++){
+        for(int m = 0; m < 4; m++){
+            Vector first = quads[8 * o + m], second = quads[8 * o + 4 + m];
+            octets[8 * o + 2 * m] = Ops::unpack_lo32(first, second);
+            octets[8 * o + 2 * m + 1] = Ops::unpack_hi32(first, second);
+        }
+    }
+    //And finally whole columns
+    for(int n = 0; n < 8; n++){
+        Ops::store_lanes(to + 2 * n * to_stride, 16 * to_stride,
+                         Ops::unpack_lo64(octets[n], octets[8 + n]));
+        Ops::store_lanes(to + (2 * n + 1) * to_stride, 16 * to_stride,
+                         Ops::unpack_hi64(octets[n], octets[8 + n]));
+    }
+}
+
+//Whole blocks are transposed with Ops, the ragged edges one byte at a time.
+//Blocks go down each strip of columns in turn, so every output row is written
+//front to back rather than 16 bytes at a time all over the output.
+template<typename Ops>
+inline void TransposeWith(const char* from, size_t from_stride, size_t height,
+                          size_t length, char* to, size_t to_stride){
+    size_t block_rows = height - height % 16;
+    size_t block_cols = length - length % Ops::WIDTH;
+    for(size_t col = 0; col < block_cols; col += Ops::WIDTH){
+        for(size_t row = 0; row < block_rows; row += 16){
+            TransposeBlock<Ops>(from + row * from_stride + col, from_stride,
+                                to + col * to_stride + row, to_stride);
+        }
+    }
+    TransposeScalarBlocked(from + block_cols, from_stride, block_rows,
+                           length - block_cols, to + block_cols * to_stride,
+                           to_stride);
+    TransposeScalarBlocked(from + block_rows * from_stride, from_stride,
+                           height - block_rows, length, to + block_rows,
+                           to_stride);
+}
+
+struct SSE2Ops{
+    typedef __m128i Vector;
+    enum{WIDTH = 16};
+
+    static Vector load(const char* p){
+        return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    }
+    static void store(char* p, Vector v){
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(p), v);
+    }
+    static Vector broadcast(char c){return _mm_set1_epi8(c);}
+    static uint64_t equal_mask(Vector a, Vector b){
+        return uint32_t(_mm_movemask_epi8(_mm_cmpeq_epi8(a, b)));
+    }
+
+    //No byte shuffle before SSSE3, so reverse the dwords, then the words in
+    //each dword, then the bytes in each word.
+    static Vector reverse(Vector v){
+        v = _mm_shuffle_epi32(v, _MM_SHUFFLE(0, 1, 2, 3));
+        v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(2, 3, 0, 1));
+        v = _mm_shufflehi_epi16(v, _MM_SHUFFLE(2, 3, 0, 1));
+        return _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+    }
+
+    static Vector unpack_lo8(Vector a, Vector b){return _mm_unpacklo_epi8(a, b);}
+    static Vector unpack_hi8(Vector a, Vector b){return _mm_unpackhi_epi8(a, b);}
+    static Vector unpack_lo16(Vector a, Vector b){return _mm_unpacklo_epi16(a, b);}
+    static Vector unpack_hi16(Vector a, Vector b){return _mm_unpackhi_epi16(a, b);}
+    static Vector unpack_lo32(Vector a, Vector b){return _mm_unpacklo_epi32(a, b);}
+    static Vector unpack_hi32(Vector a, Vector b){return _mm_unpackhi_epi32(a, b);}
+    static Vector unpack_lo64(Vector a, Vector b){return _mm_unpacklo_epi64(a, b);}
+    static Vector unpack_hi64(Vector a, Vector b){return _mm_unpackhi_epi64(a, b);}
+    static void store_lanes(char* p, size_t, Vector v){store(p, v);}
+};
+
+#endif
+
+}
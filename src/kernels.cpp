@@ -0,0 +1,69 @@
+#include "kernels.hpp"
+#include "kernels-impl.hpp"
+
+#include <cstddef>
+#include <vector>
+using std::vector;
+
+//The scalar set, the reference every other set is checked against
+static void ReverseCopyScalar(char* to, const char* from, size_t size){
+    for(size_t i = 0; i < size; i++){
+        to[i] = from[size - 1 - i];
+    }
+}
+
+static void TransposeScalar(const char* from, size_t from_stride,
+                            size_t height, size_t length, char* to,
+                            size_t to_stride){
+    TransposeScalarBlocked(from, from_stride, height, length, to, to_stride);
+}
+
+static const char* FindByteScalar(const char* begin, const char* end, char c){
+    while(begin != end && *begin != c){
+        begin++;
+    }
+    return begin;
+}
+
+#if defined(__x86_64__)
+
+//Every x86-64 CPU has SSE2, so this set needs no separate file
+static void ReverseCopySSE2(char* to, const char* from, size_t size){
+    ReverseCopyWith<SSE2Ops>(to, from, size);
+}
+
+static void TransposeSSE2(const char* from, size_t from_stride, size_t height,
+                          size_t length, char* to, size_t to_stride){
+    TransposeWith<SSE2Ops>(from, from_stride, height, length, to, to_stride);
+}
+
+static const char* FindByteSSE2(const char* begin, const char* end, char c){
+    return FindByteWith<SSE2Ops>(begin, end, c);
+}
+
+#endif
+
+vector<KernelSet> SupportedKernelSets(){
+    vector<KernelSet> result;
+    result.push_back(KernelSet{"scalar", ReverseCopyScalar, TransposeScalar,
+                               FindByteScalar});
+#if defined(__x86_64__)
+    result.push_back(KernelSet{"sse2", ReverseCopySSE2, TransposeSSE2,
+                               FindByteSSE2});
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2")){
+        result.push_back(KernelSet{"avx2", ReverseCopyAVX2, TransposeAVX2,
+                                   FindByteAVX2});
+    }
+    if(__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw")){
+        result.push_back(KernelSet{"avx512", ReverseCopyAVX512, TransposeAVX2,
+                                   FindByteAVX512});
+    }
+#endif
+    return result;
+}
+
+const KernelSet& ActiveKernelSet(){
+    static const KernelSet active = SupportedKernelSets().back();
+    return active;
+}
@@ -0,0 +1,56 @@
+/* Small byte kernels behind the hot loops of resampling and alignment I/O:
+ *     reverse copy - copying a left running walk segment of a row
+ *     transpose    - converting between row-major and column-major matrices
+ *     find byte    - finding the next newline while parsing FASTA
+ *
+ * Each has a scalar version and, on x86-64, SSE2, AVX2 and AVX-512BW ones (the
+ * AVX-512 set transposes with AVX2, which is faster there). The fastest set
+ * the CPU supports is picked the first time a kernel is called, so the same
+ * binary runs on every node without being rebuilt for it. The vector
+ * versions live in kernels-avx2.cpp and kernels-avx512.cpp, which are compiled
+ * for their instruction sets, and must only be reached through this dispatch.
+ *
+ * Every set gives exactly the same results, bench/kernels.cpp checks each one
+ * against the scalar set and measures them.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+//One implementation of every kernel
+struct KernelSet{
+    const char* name;
+
+    //to[i] = from[size - 1 - i] for i < size, the ranges must not overlap
+    void (*reverse_copy)(char* to, const char* from, size_t size);
+
+    //Transposes height rows of length bytes, from_stride apart, into length
+    //rows of height bytes, to_stride apart. The matrices must not overlap.
+    void (*transpose)(const char* from, size_t from_stride, size_t height,
+                      size_t length, char* to, size_t to_stride);
+
+    //The first c in [begin, end), or end if there isn't one
+    const char* (*find_byte)(const char* begin, const char* end, char c);
+};
+
+//Every set this CPU can run, the scalar set first and the fastest last
+std::vector<KernelSet> SupportedKernelSets();
+
+//The fastest supported set, chosen once
+const KernelSet& ActiveKernelSet();
+
+inline void ReverseCopy(char* to, const char* from, size_t size){
+    ActiveKernelSet().reverse_copy(to, from, size);
+}
+
+inline void TransposeBytes(const char* from, size_t from_stride, size_t height,
+                           size_t length, char* to, size_t to_stride){
+    ActiveKernelSet().transpose(from, from_stride, height, length, to,
+                                to_stride);
+}
+
+inline const char* FindByte(const char* begin, const char* end, char c){
+    return ActiveKernelSet().find_byte(begin, end, c);
+}
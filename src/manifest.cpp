@@ -0,0 +1,345 @@
+#include "manifest.hpp"
+#include "sequence.hpp"
+#include "pipeline.hpp"
+#include "threadpool.hpp"
+#include "binary.hpp"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstdio>
+
+#include <cstdint>
+#include <cstring>
+using std::memcpy;
+#include <stdexcept>
+using std::runtime_error;
+#include <iomanip>
+using std::setw; using std::setfill; using std::hex;
+using std::setprecision;
+#include <fstream>
+using std::ifstream; using std::ofstream;
+#include <sstream>
+using std::ostringstream; using std::istringstream;
+#include <string>
+using std::string; using std::getline; using std::to_string;
+#include <vector>
+using std::vector;
+#include <map>
+using std::map;
+
+//MurmurHash3's fmix64. The constant added afterwards keeps zero from mapping
+//to itself, which would let runs of zero words through unhashed.
+static inline uint64_t Mix(uint64_t hash){
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdULL;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ULL;
+    hash ^= hash >> 33;
+    return hash + 0x9e3779b97f4a7c15ULL;
+}
+
+uint64_t Checksum(const char* data, size_t size, uint64_t hash){
+    size_t words = size / sizeof(uint64_t);
+    for(size_t i = 0; i < words; i++){
+        uint64_t word;
+        memcpy(&word, data + i * sizeof(uint64_t), sizeof(uint64_t));
+        hash = Mix(hash ^ word);
+    }
+    for(size_t i = words * sizeof(uint64_t); i < size; i++){
+        hash = Mix(hash ^ uint8_t(data[i]));
+    }
+    return hash;
+}
+
+//A checksum as it is written in the manifest, 16 hex digits
+static string FormatChecksum(uint64_t checksum){
+    ostringstream stream;
+    stream << hex << setw(16) << setfill('0') << checksum;
+    return stream.str();
+}
+
+map<string, string> ManifestParameters(const PipelineConfig& config,
+                                       const CharMatrix& input,
+                                       const vector<string>& taxa){
+    map<string, string> result;
+    result["seed"] = to_string(config.seed);
+    ostringstream bias;
+    bias << setprecision(17) << config.bias;
+    result["bias"] = bias.str();
+    result["length"] = to_string(config.length);
+    result["format"] = FormatExtension(config.format);
+
+    string partitions;
+    for(const Partition& partition : config.partitions){
+        if(!partitions.empty()){
+            partitions += ',';
+        }
+        partitions += to_string(partition.start) + ":" + to_string(partition.end);
+    }
+    result["partitions"] = partitions.empty() ? "none" : partitions;
+
+    //The input is identified by its contents rather than its path
+    uint64_t checksum = CHECKSUM_BASIS;
+    for(size_t row_index = 0; row_index < input.height(); row_index++){
+        checksum = Checksum(taxa[row_index].data(), taxa[row_index].size() + 1,
+                            checksum);
+        checksum = Checksum(input.row(row_index), input.length(), checksum);
+    }
+    result["input"] = to_string(input.height()) + "x" +
+                      to_string(input.length()) + " " + FormatChecksum(checksum);
+    return result;
+}
+
+//A replicate line of the manifest, without the newline
+static string FormatEntry(const ManifestEntry& entry){
+    return "replicate\t" + to_string(entry.replicate) + "\t" +
+           to_string(entry.alignment_size) + "\t" +
+           FormatChecksum(entry.alignment_checksum) + "\t" +
+           to_string(entry.alignment_mtime) + "\t" +
+           to_string(entry.walk_size) + "\t" +
+           FormatChecksum(entry.walk_checksum) + "\t" +
+           to_string(entry.walk_mtime);
+}
+
+bool ReadRunManifest(const string& path, RunManifest& manifest){
+    ifstream file(path);
+    if(!file.is_open()){
+        return false;
+    }
+
+    manifest.parameters.clear();
+    manifest.replicates.clear();
+    string line;
+    size_t line_num = 0;
+    string version;
+    while(getline(file, line)){
+        line_num++;
+        if(line.empty()){
+            continue;
+        }
+        size_t tab = line.find('\t');
+        if(tab == string::npos){
+            throw runtime_error("Line " + to_string(line_num) + " of the manifest "
+                                "\"" + path + "\" has no value");
+        }
+        string key = line.substr(0, tab);
+        if(key == "version"){
+            version = line.substr(tab + 1);
+            continue;
+        }
+        if(key != "replicate"){
+            manifest.parameters[key] = line.substr(tab + 1);
+            continue;
+        }
+
+        istringstream fields(line.substr(tab + 1));
+        ManifestEntry entry;
+        string alignment_checksum, walk_checksum;
+        fields >> entry.replicate >> entry.alignment_size >> alignment_checksum
+               >> entry.alignment_mtime >> entry.walk_size >> walk_checksum
+               >> entry.walk_mtime;
+        try{
+            if(!fields){
+                throw std::invalid_argument(line);
+            }
+            entry.alignment_checksum = std::stoull(alignment_checksum, nullptr, 16);
+            entry.walk_checksum = std::stoull(walk_checksum, nullptr, 16);
+        }
+        catch(std::logic_error& e){
+            throw runtime_error("Line " + to_string(line_num) + " of the manifest "
+                                "\"" + path + "\" is not a valid replicate");
+        }
+        manifest.replicates[entry.replicate] = entry;
+    }
+    if(version != to_string(MANIFEST_VERSION)){
+        throw runtime_error("The manifest \"" + path + "\" was written by another "
+                            "version of seres-resample, so its replicates can't "
+                            "be checked");
+    }
+    return true;
+}
+
+void WriteRunManifest(const string& path, const RunManifest& manifest){
+    string temporary = path + ".tmp";
+    {
+        ofstream file(temporary);
+        if(!file.is_open()){
+            throw runtime_error("Could not open \"" + temporary + "\" for writing");
+        }
+        file << "version\t" << MANIFEST_VERSION << '\n';
+        for(const auto& parameter : manifest.parameters){
+            file << parameter.first << '\t' << parameter.second << '\n';
+        }
+        for(const auto& replicate : manifest.replicates){
+            file << FormatEntry(replicate.second) << '\n';
+        }
+        file.close();
+        if(!file){
+            throw runtime_error("Could not write to \"" + temporary + "\"");
+        }
+    }
+    if(std::rename(temporary.c_str(), path.c_str()) != 0){
+        throw runtime_error("Could not replace the manifest \"" + path + "\"");
+    }
+}
+
+//Checksum of an open file through a mapping, expected_size is checked against
+//the file first unless it is UINT64_MAX. Closes the file either way.
+static bool MappedChecksum(int fd, uint64_t expected_size, uint64_t& size,
+                           uint64_t& checksum){
+    struct stat info;
+    if(fstat(fd, &info) != 0 ||
+       (expected_size != UINT64_MAX && uint64_t(info.st_size) != expected_size)){
+        close(fd);
+        return false;
+    }
+    size = info.st_size;
+    if(size == 0){
+        close(fd);
+        checksum = Checksum(nullptr, 0);
+        return true;
+    }
+    void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(mapped == MAP_FAILED){
+        return false;
+    }
+    madvise(mapped, size, MADV_SEQUENTIAL);
+    checksum = Checksum(static_cast<const char*>(mapped), size);
+    munmap(mapped, size);
+    return true;
+}
+
+bool FileChecksum(const string& path, uint64_t& size, uint64_t& checksum){
+    int fd = open(path.c_str(), O_RDONLY);
+    return fd >= 0 && MappedChecksum(fd, UINT64_MAX, size, checksum);
+}
+
+//Size and modification time of the file at the path, from a single stat
+static bool FileStamp(const string& path, uint64_t& size, uint64_t& mtime){
+    struct stat info;
+    if(stat(path.c_str(), &info) != 0){
+        return false;
+    }
+    size = info.st_size;
+    mtime = uint64_t(info.st_mtim.tv_sec) * 1000000000 + info.st_mtim.tv_nsec;
+    return true;
+}
+
+//True if the file at the path has the given size and modification time, or
+//with full, the given size and checksum. The size is checked first so that
+//most damaged files are caught without reading them. The time found is put
+//back in mtime.
+static bool VerifyFile(const string& path, uint64_t size, uint64_t& mtime,
+                       uint64_t checksum, bool full){
+    uint64_t found_size, found_mtime;
+    if(!FileStamp(path, found_size, found_mtime) || found_size != size ||
+       (!full && found_mtime != mtime)){
+        return false;
+    }
+    mtime = found_mtime;
+    if(!full){
+        return true;
+    }
+    int fd = open(path.c_str(), O_RDONLY);
+    uint64_t found_checksum;
+    return fd >= 0 && MappedChecksum(fd, size, found_size, found_checksum) &&
+           found_checksum == checksum;
+}
+
+vector<size_t> VerifyReplicates(RunManifest& manifest, const string& directory,
+                                AlignmentFormat format, size_t first,
+                                size_t number, size_t threads, bool full){
+    vector<ManifestEntry> candidates;
+    auto begin = manifest.replicates.lower_bound(first);
+    auto end = manifest.replicates.lower_bound(first + number);
+    for(auto it = begin; it != end; it++){
+        candidates.push_back(it->second);
+    }
+
+    vector<char> intact(candidates.size(), 0);
+    {
+        ThreadPool pool(threads);
+        string extension = "." + FormatExtension(format);
+        string directory_prefix = directory.empty() || directory.back() == '/' ?
+                                  directory : directory + "/";
+        for(size_t i = 0; i < candidates.size(); i++){
+            pool.submit([&candidates, &intact, &extension, &directory_prefix,
+                         full, i]{
+                ManifestEntry& entry = candidates[i];
+                string prefix = directory_prefix + "replicate-" +
+                                to_string(entry.replicate);
+                intact[i] = VerifyFile(prefix + extension, entry.alignment_size,
+                                       entry.alignment_mtime,
+                                       entry.alignment_checksum, full) &&
+                            VerifyFile(prefix + ".walk", entry.walk_size,
+                                       entry.walk_mtime, entry.walk_checksum,
+                                       full);
+            });
+        }
+        pool.wait();
+    }
+
+    vector<size_t> result;
+    for(size_t i = 0; i < candidates.size(); i++){
+        if(intact[i]){
+            result.push_back(candidates[i].replicate);
+            manifest.replicates[candidates[i].replicate] = candidates[i];
+        }
+    }
+    return result;
+}
+
+//Fill in the sizes and times of a replicate's files once they are written
+static void StampEntry(ManifestEntry& entry, const string& alignment_path,
+                       const string& walk_path){
+    if(!FileStamp(alignment_path, entry.alignment_size, entry.alignment_mtime)){
+        throw runtime_error("Could not stat \"" + alignment_path + "\"");
+    }
+    if(!FileStamp(walk_path, entry.walk_size, entry.walk_mtime)){
+        throw runtime_error("Could not stat \"" + walk_path + "\"");
+    }
+}
+
+ManifestWriter::ManifestWriter(const string& path):
+    file_(path, std::ios::app), path_(path){
+    if(!file_.is_open()){
+        throw runtime_error("Could not open the manifest \"" + path + "\"");
+    }
+}
+
+void ManifestWriter::append(size_t replicate, const string& alignment_path,
+                            const string& alignment, const string& walk_path,
+                            const string& walk_text){
+    ManifestEntry entry;
+    entry.replicate = replicate;
+    entry.alignment_checksum = Checksum(alignment.data(), alignment.size());
+    entry.walk_checksum = Checksum(walk_text.data(), walk_text.size());
+    StampEntry(entry, alignment_path, walk_path);
+    write(entry);
+}
+
+void ManifestWriter::append_file(size_t replicate, const string& alignment_path,
+                                 const string& walk_path,
+                                 const string& walk_text){
+    ManifestEntry entry;
+    entry.replicate = replicate;
+    if(!FileChecksum(alignment_path, entry.alignment_size,
+                     entry.alignment_checksum)){
+        throw runtime_error("Could not read back \"" + alignment_path + "\"");
+    }
+    entry.walk_checksum = Checksum(walk_text.data(), walk_text.size());
+    StampEntry(entry, alignment_path, walk_path);
+    write(entry);
+}
+
+
+void ManifestWriter::write(const ManifestEntry& entry){
+    file_ << FormatEntry(entry) << '\n';
+    file_.flush();
+    if(!file_){
+        throw runtime_error("Could not write to the manifest \"" + path_ + "\"");
+    }
+}
@@ -0,0 +1,131 @@
+/* The run manifest lets seres-resample extend or repair an earlier run instead
+ * of starting over. Every run writes seres.manifest next to its replicates, a
+ * text file of tab separated lines:
+ *
+ *     version      3                   the format of the manifest
+ *     seed         <seed>              parameter lines, one per key, which
+ *     bias         <bias>              must all match for an earlier run's
+ *     ...                              replicates to be reused
+ *     replicate    <number> <alignment size> <alignment checksum>
+ *                  <alignment mtime> <walk size> <walk checksum> <walk mtime>
+ *
+ * Replicate lines are appended as replicates are written, so a run which is
+ * killed part way still lists everything it finished. If a replicate appears
+ * more than once the last line wins. Modification times are in nanoseconds
+ * since the epoch, as the files had them once written.
+ *
+ * By default existing replicates are only checked against their sizes and
+ * modification times, a stat per file, so extending a run costs only the new
+ * replicates however large the old ones are. A full check also hashes every
+ * file and compares the checksums, for when a file may have been damaged
+ * without its time changing, or the times were lost by copying the files.
+ * Nothing is parsed or resampled to check a replicate either way. Manifests of
+ * another version are refused rather than being checked against values they
+ * don't hold or that were computed differently.
+ */
+
+#pragma once
+
+#include "sequence.hpp"
+#include "pipeline.hpp"
+#include "binary.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <map>
+#include <fstream>
+
+//Name of the manifest inside the output directory
+const char MANIFEST_FILE[] = "seres.manifest";
+
+//Bumped whenever the manifest's lines or checksums change meaning. Version 1
+//used a word-wise FNV hash, version 2 didn't record modification times.
+const unsigned MANIFEST_VERSION = 3;
+
+//A 64 bit hash taken a word at a time so that hashing keeps up with writing.
+//Each word is xored into the state, which is then put through MurmurHash3's
+//fmix64 finalizer, so every bit of the input affects every bit of the result.
+//Words are read in native byte order, so checksums only compare between
+//machines of the same endianness. Pass a previous result as the hash to
+//continue hashing across several buffers.
+const uint64_t CHECKSUM_BASIS = 0xcbf29ce484222325ULL;
+uint64_t Checksum(const char* data, size_t size,
+                  uint64_t hash = CHECKSUM_BASIS);
+
+//What is recorded about one written replicate
+struct ManifestEntry{
+    size_t replicate = 0;
+    uint64_t alignment_size = 0;
+    uint64_t alignment_checksum = 0;
+    uint64_t alignment_mtime = 0;
+    uint64_t walk_size = 0;
+    uint64_t walk_checksum = 0;
+    uint64_t walk_mtime = 0;
+};
+
+struct RunManifest{
+    std::map<std::string, std::string> parameters;
+    std::map<size_t, ManifestEntry> replicates;     //By replicate number
+};
+
+//The parameters which decide what every replicate of a run looks like, as
+//they are recorded in the manifest. The range of replicates isn't one of them,
+//so a run can be extended with more replicates or another range.
+std::map<std::string, std::string> ManifestParameters(
+    const PipelineConfig& config, const CharMatrix& input,
+    const std::vector<std::string>& taxa);
+
+//Size and checksum of the file at a path, read through a mapping. Returns
+//false if the file can't be opened or read.
+bool FileChecksum(const std::string& path, uint64_t& size, uint64_t& checksum);
+
+//Reads a manifest, returning false if there is no file at the path. Throws
+//std::runtime_error if the file exists but can't be read as a manifest, or is
+//of another version.
+bool ReadRunManifest(const std::string& path, RunManifest&);
+
+//Writes a manifest from scratch, through a temporary file which replaces the
+//old one once it is complete. Throws std::runtime_error on failure.
+void WriteRunManifest(const std::string& path, const RunManifest&);
+
+//Checks which of the manifest's replicates numbered [first, first + number)
+//are still in the directory as they were written, or in the working directory
+//if it is empty, on a pool of threads. Only sizes and
+//modification times are compared unless full is set, then the files are read
+//and their sizes and checksums compared instead. The times of the replicates
+//found intact are updated in the manifest, so that after a full check a later
+//one without it passes too. Returns their numbers sorted.
+std::vector<size_t> VerifyReplicates(RunManifest&, const std::string& directory,
+                                     AlignmentFormat format,
+                                     size_t first, size_t number,
+                                     size_t threads, bool full = false);
+
+//Appends replicate lines to an existing manifest, flushing after each one.
+class ManifestWriter{
+    private:
+        std::ofstream file_;
+        std::string path_;
+
+        void write(const ManifestEntry& entry);
+
+    public:
+        //Throws std::runtime_error if the manifest can't be opened
+        explicit ManifestWriter(const std::string& path);
+
+        //Records a replicate once its files are written, checksummed from
+        //the buffers they were written from. The files are only looked at
+        //for their modification times. Throws std::runtime_error if they
+        //can't be, or the line can't be written.
+        void append(size_t replicate, const std::string& alignment_path,
+                    const std::string& alignment, const std::string& walk_path,
+                    const std::string& walk_text);
+
+        //The same for a replicate whose alignment went straight to disk
+        //without being formatted into memory, so it is read back from the
+        //file to be checksummed.
+        void append_file(size_t replicate, const std::string& alignment_path,
+                         const std::string& walk_path,
+                         const std::string& walk_text);
+};
@@ -0,0 +1,154 @@
+#include "output.hpp"
+#include "sequence.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+using std::strerror;
+#include <algorithm>
+using std::lower_bound; using std::min; using std::max;
+#include <thread>
+using std::thread;
+#include <mutex>
+using std::mutex; using std::lock_guard;
+#include <stdexcept>
+using std::runtime_error;
+#include <string>
+using std::string;
+#include <vector>
+using std::vector;
+
+//How much formatted text a thread gathers before writing it out. Rows longer
+//than this are written straight from the matrix without being copied.
+static const size_t CHUNK_BYTES = 4 << 20;
+
+uint64_t FASTASize(size_t length, const vector<string>& taxa){
+    uint64_t total = 0;
+    for(const string& name : taxa){
+        total += name.size() + length + 3;
+    }
+    return total;
+}
+
+//Write exactly size bytes at offset, throws std::runtime_error on failure
+static void WriteAt(int fd, const char* data, size_t size, uint64_t offset,
+                    const string& path){
+    while(size > 0){
+        ssize_t result = pwrite(fd, data, size, offset);
+        if(result < 0 && errno == EINTR){
+            continue;
+        }
+        if(result <= 0){
+            throw runtime_error("Could not write to \"" + path + "\": " +
+                                strerror(errno));
+        }
+        data += result;
+        size -= result;
+        offset += result;
+    }
+}
+
+//Format and write rows [begin, end), the first of which starts at offset
+static void WriteRows(int fd, const string& path, const CharMatrix& matrix,
+                      const vector<string>& taxa, const vector<size_t>* rows,
+                      size_t begin, size_t end, uint64_t offset){
+    size_t num_cols = matrix.length();
+    string chunk;
+    chunk.reserve(CHUNK_BYTES);
+    for(size_t row_index = begin; row_index < end; row_index++){
+        const char* row = matrix.row(rows == nullptr ? row_index
+                                                     : (*rows)[row_index]);
+        chunk += '>';
+        chunk += taxa[row_index];
+        chunk += '\n';
+        if(num_cols >= CHUNK_BYTES){
+            WriteAt(fd, chunk.data(), chunk.size(), offset, path);
+            offset += chunk.size();
+            chunk.clear();
+            WriteAt(fd, row, num_cols, offset, path);
+            offset += num_cols;
+        }
+        else{
+            chunk.append(row, num_cols);
+        }
+        chunk += '\n';
+        if(chunk.size() >= CHUNK_BYTES){
+            WriteAt(fd, chunk.data(), chunk.size(), offset, path);
+            offset += chunk.size();
+            chunk.clear();
+        }
+    }
+    WriteAt(fd, chunk.data(), chunk.size(), offset, path);
+}
+
+void WriteFASTAParallel(const string& path, const CharMatrix& matrix,
+                        const vector<string>& taxa, size_t threads,
+                        const vector<size_t>* rows){
+
+    size_t num_rows = rows == nullptr ? matrix.height() : rows->size();
+    if(num_rows != taxa.size()){
+        throw runtime_error("Number of taxa does not match the alignment");
+    }
+
+    //Where every row starts, with the total size at the end
+    vector<uint64_t> offsets(num_rows + 1, 0);
+    for(size_t row_index = 0; row_index < num_rows; row_index++){
+        offsets[row_index + 1] = offsets[row_index] +
+                                 taxa[row_index].size() + matrix.length() + 3;
+    }
+    uint64_t total = offsets.back();
+
+    //Reserve the whole file up front so the writers never extend it, falling
+    //back on a sparse file where the filesystem can't preallocate.
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if(fd < 0){
+        throw runtime_error("Could not open \"" + path + "\" for writing");
+    }
+    if(total > 0 && fallocate(fd, 0, 0, total) != 0 &&
+       ftruncate(fd, total) != 0){
+        string reason = strerror(errno);
+        close(fd);
+        throw runtime_error("Could not allocate \"" + path + "\": " + reason);
+    }
+
+    //Split the rows into ranges of about the same number of bytes, every
+    //range starts at the first row beginning at or after its share.
+    threads = max<size_t>(1, min<size_t>(threads, num_rows));
+    vector<size_t> boundaries(threads + 1, num_rows);
+    boundaries[0] = 0;
+    for(size_t i = 1; i < threads; i++){
+        uint64_t target = total / threads * i;
+        boundaries[i] = lower_bound(offsets.begin(), offsets.end() - 1,
+                                    target) - offsets.begin();
+    }
+
+    string error;
+    mutex error_mutex;
+    auto work = [&](size_t i){
+        try{
+            WriteRows(fd, path, matrix, taxa, rows, boundaries[i],
+                      boundaries[i + 1], offsets[boundaries[i]]);
+        }
+        catch(runtime_error& e){
+            lock_guard<mutex> lock(error_mutex);
+            error = e.what();
+        }
+    };
+    vector<thread> workers;
+    for(size_t i = 1; i < threads; i++){
+        workers.emplace_back(work, i);
+    }
+    work(0);
+    for(thread& worker : workers){
+        worker.join();
+    }
+
+    if(close(fd) != 0 && error.empty()){
+        error = "Could not write to \"" + path + "\": " + strerror(errno);
+    }
+    if(!error.empty()){
+        throw runtime_error(error);
+    }
+}
@@ -0,0 +1,34 @@
+/* Writing very large FASTA replicates in parallel. A replicate's FASTA text is
+ * fully determined by its taxa and its length, so the byte offset at which
+ * every row starts is known before anything is formatted. The file is
+ * preallocated at its final size, its rows are split into contiguous ranges of
+ * roughly equal size, and each range is formatted and written with pwrite by
+ * its own thread. Nothing depends on what another thread has written, so a
+ * single replicate goes out as fast as the disk takes it rather than as fast
+ * as one thread can format it.
+ *
+ * The output is byte for byte what FormatFASTA produces.
+ */
+
+#pragma once
+
+#include "sequence.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+//Replicates whose FASTA text is at least this large are written by
+//WriteFASTAParallel in the pipeline, smaller ones aren't worth the threads.
+const uint64_t PARALLEL_WRITE_BYTES = uint64_t(64) << 20;
+
+//Size of the FASTA text for a matrix of the given length with these taxa
+uint64_t FASTASize(size_t length, const std::vector<std::string>& taxa);
+
+//Writes the matrix as FASTA to path using up to threads threads. Rows maps
+//output rows to matrix rows, as for FormatFASTA. Throws std::runtime_error if
+//the file can't be written, in which case it is left incomplete.
+void WriteFASTAParallel(const std::string& path, const CharMatrix& matrix,
+                        const std::vector<std::string>& taxa, size_t threads,
+                        const std::vector<size_t>* rows = nullptr);
@@ -0,0 +1,145 @@
+#include "partition.hpp"
+#include "walk.hpp"
+#include "resample.hpp"
+#include "threadpool.hpp"
+
+#include <algorithm>
+using std::sort;
+#include <stdexcept>
+using std::runtime_error;
+#include <istream>
+using std::istream;
+#include <sstream>
+using std::istringstream;
+#include <string>
+using std::string; using std::getline; using std::to_string;
+#include <vector>
+using std::vector;
+#include <random>
+using std::mt19937_64;
+
+vector<Partition> ReadPartitions(istream& stream, size_t input_length){
+    vector<Partition> result;
+
+    string line;
+    size_t line_num = 0;
+    while(getline(stream, line)){
+        line_num++;
+
+        //Skip comments and blank lines, and drop any name before '='
+        size_t first = line.find_first_not_of(" \t\r");
+        if(first == string::npos || line[first] == '#'){
+            continue;
+        }
+        size_t equals = line.find('=');
+        if(equals != string::npos){
+            line.erase(0, equals + 1);
+        }
+
+        Partition partition;
+        char sep = 0;
+        string rest;
+        istringstream fields(line);
+        if(!(fields >> partition.start >> sep >> partition.end) || sep != ':' ||
+           (fields >> rest)){
+            throw runtime_error("Line " + to_string(line_num) + 
+                                " of the partition file is not START:END");
+        }
+        if(partition.start >= partition.end || partition.end > input_length){
+            throw runtime_error("Partition on line " + to_string(line_num) +
+                                " is empty or runs past the end of the input");
+        }
+        result.push_back(partition);
+    }
+
+    if(result.empty()){
+        throw runtime_error("The partition file doesn't contain any partitions");
+    }
+
+    //Check for overlaps on a sorted copy, the original order is kept since it
+    //decides the order partitions appear in the replicate.
+    vector<Partition> sorted = result;
+    sort(sorted.begin(), sorted.end(), 
+         [](const Partition& a, const Partition& b){return a.start < b.start;});
+    for(size_t i = 1; i < sorted.size(); i++){
+        if(sorted[i].start < sorted[i-1].end){
+            throw runtime_error("Partitions " + to_string(sorted[i-1].start) +
+                                ":" + to_string(sorted[i-1].end) + " and " + 
+                                to_string(sorted[i].start) + ":" + 
+                                to_string(sorted[i].end) + " overlap");
+        }
+    }
+
+    return result;
+}
+
+vector<size_t> PartitionLengths(const vector<Partition>& partitions,
+                                size_t total_length){
+    size_t total_width = 0;
+    for(const Partition& partition : partitions){
+        total_width += partition.width();
+    }
+
+    //Give every partition the floor of its share, then hand out what is left
+    //to the partitions with the largest remainders.
+    vector<size_t> lengths(partitions.size());
+    vector<double> remainders(partitions.size());
+    size_t assigned = 0;
+    for(size_t i = 0; i < partitions.size(); i++){
+        double share = double(total_length) * partitions[i].width() / total_width;
+        lengths[i] = size_t(share);
+        remainders[i] = share - lengths[i];
+        assigned += lengths[i];
+    }
+    vector<size_t> order(partitions.size());
+    for(size_t i = 0; i < order.size(); i++){
+        order[i] = i;
+    }
+    sort(order.begin(), order.end(), [&remainders](size_t a, size_t b){
+        return remainders[a] > remainders[b];
+    });
+    for(size_t i = 0; assigned < total_length; i = (i + 1) % order.size()){
+        lengths[order[i]]++;
+        assigned++;
+    }
+
+    return lengths;
+}
+
+RandomWalk GeneratePartitionedWalk(const vector<Partition>& partitions,
+                                   const vector<size_t>& lengths,
+                                   double turnaround_bias, mt19937_64& rng,
+                                   ThreadPool* pool){
+
+    //Seeds are drawn up front so the walks don't depend on scheduling
+    vector<mt19937_64::result_type> seeds(partitions.size());
+    for(auto& seed : seeds){
+        seed = rng();
+    }
+
+    //Each walk is drawn within its partition, as if it were the whole input
+    vector<RandomWalk> walks(partitions.size());
+    for(size_t i = 0; i < partitions.size(); i++){
+        auto task = [&partitions, &lengths, &seeds, &walks, turnaround_bias, i]{
+            mt19937_64 partition_rng(seeds[i]);
+            walks[i] = GenerateRandomWalk(partitions[i].width(), lengths[i],
+                                          turnaround_bias, partition_rng);
+        };
+        if(pool != nullptr){
+            pool->submit(task);
+        }
+        else{
+            task();
+        }
+    }
+    if(pool != nullptr){
+        pool->wait();
+    }
+
+    //Then shifted into place and joined together
+    RandomWalk result;
+    for(size_t i = 0; i < partitions.size(); i++){
+        result.append_partition(walks[i], partitions[i].start);
+    }
+    return result;
+}
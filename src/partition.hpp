@@ -0,0 +1,44 @@
+/* Partitioned resampling, for supermatrices built by concatenating several
+ * loci. Rather than walking across the whole width of the input, an
+ * independent walk is drawn inside each partition, so walks turn around at
+ * partition edges and never carry sites from one locus into another. The
+ * per-partition walks are concatenated into one walk which drives a single
+ * pass of Resample over the input.
+ */
+
+#pragma once
+
+#include "walk.hpp"
+#include "threadpool.hpp"
+
+#include <cstddef>
+#include <vector>
+#include <istream>
+#include <random>
+
+//A range of columns [start, end) of the input alignment
+struct Partition{
+    size_t start;
+    size_t end;
+
+    size_t width() const{return end - start;};
+};
+
+//Read a partition file. Each non blank line holds one range of columns as
+//START:END, 0 based and end exclusive, optionally preceded by a name and '='
+//as in "gene1 = 0:500". Lines starting with '#' are skipped. Partitions may
+//not overlap or run past input_length. Throws std::runtime_error otherwise.
+std::vector<Partition> ReadPartitions(std::istream&, size_t input_length);
+
+//Split a replicate length between the partitions in proportion to their
+//widths. If the total is the sum of the widths each partition keeps its width.
+std::vector<size_t> PartitionLengths(const std::vector<Partition>&,
+                                     size_t total_length);
+
+//Draw one walk per partition and concatenate them in partition order. Every
+//partition gets its own rng seeded from the one passed in, so the result is
+//the same whether or not a pool is given to generate them in parallel.
+RandomWalk GeneratePartitionedWalk(const std::vector<Partition>&,
+                                   const std::vector<size_t>& lengths,
+                                   double turnaround_bias, std::mt19937_64& rng,
+                                   ThreadPool* pool = nullptr);
@@ -0,0 +1,294 @@
+#include "pipeline.hpp"
+#include "sequence.hpp"
+#include "walk.hpp"
+#include "resample.hpp"
+#include "queue.hpp"
+#include "partition.hpp"
+#include "threadpool.hpp"
+#include "binary.hpp"
+#include "manifest.hpp"
+#include "dedup.hpp"
+#include "output.hpp"
+
+#include <algorithm>
+using std::binary_search;
+#include <chrono>
+#include <thread>
+using std::thread;
+#include <stdexcept>
+#include <exception>
+#include <iomanip>
+using std::setw; using std::fixed; using std::setprecision; using std::left;
+#include <fstream>
+using std::ofstream;
+#include <sstream>
+using std::ostringstream;
+#include <ostream>
+using std::ostream; using std::endl;
+#include <string>
+using std::string; using std::to_string;
+#include <vector>
+using std::vector;
+#include <random>
+using std::mt19937_64;
+#include <memory>
+using std::unique_ptr;
+
+typedef std::chrono::steady_clock Clock;
+
+//Seconds elapsed since a given time point
+static double SecondsSince(Clock::time_point start){
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+//Everything needed to carry one replicate through the pipeline. These are
+//recycled, so the matrix and strings keep their allocations between uses.
+struct ReplicateBuffer{
+    size_t number = 0;
+    RandomWalk walk;
+    CharMatrix matrix;
+    string alignment;           //Left empty if direct
+    string walk_text;
+    bool direct = false;        //Written by WriteFASTAParallel
+};
+
+RandomWalk DrawReplicateWalk(const PipelineConfig& config, size_t input_length,
+                             size_t trial_num, ThreadPool* pool){
+    mt19937_64 rng = ReplicateRNG(config.seed, trial_num);
+    if(config.partitions.empty()){
+        return GenerateRandomWalk(input_length, config.length, config.bias, rng);
+    }
+    return GeneratePartitionedWalk(config.partitions,
+        PartitionLengths(config.partitions, config.length), config.bias, rng,
+        pool);
+}
+
+//Stage 1, draw the walks in replicate order, each from its own rng.
+//Partitioned walks are drawn partition by partition on a pool of threads.
+static void GenerateStage(const PipelineConfig& config,
+                          size_t input_length, vector<ReplicateBuffer>& buffers,
+                          BoundedQueue<size_t>& free_buffers,
+                          BoundedQueue<size_t>& generated, StageStats& stats){
+    unique_ptr<ThreadPool> pool;
+    if(!config.partitions.empty() && config.threads > 1){
+        pool.reset(new ThreadPool(config.threads));
+    }
+
+    size_t index;
+    size_t last = config.first + config.number;
+    for(size_t trial_num=config.first; trial_num<last; trial_num++){
+        if(binary_search(config.skip.begin(), config.skip.end(), trial_num)){
+            continue;
+        }
+        if(!free_buffers.pop(index)){
+            break;
+        }
+
+        Clock::time_point start = Clock::now();
+        buffers[index].number = trial_num;
+        buffers[index].walk = DrawReplicateWalk(config, input_length, trial_num,
+                                                pool.get());
+        stats.busy_seconds += SecondsSince(start);
+        stats.items++;
+
+        if(!generated.push(index)){
+            break;
+        }
+    }
+    generated.close();
+}
+
+//Stage 2, apply the walk and format both output files into memory. If the
+//input had duplicate rows only the unique ones are resampled, and rows maps
+//them back out when formatting. Large FASTA replicates are left for stage 3 to
+//format as it writes them.
+static void ResampleStage(const PipelineConfig& config,
+                          const CharMatrix& input_sequence,
+                          const vector<size_t>* rows,
+                          const vector<string>& taxa,
+                          vector<ReplicateBuffer>& buffers,
+                          BoundedQueue<size_t>& generated,
+                          BoundedQueue<size_t>& formatted, StageStats& stats){
+    size_t index;
+    while(generated.pop(index)){
+        Clock::time_point start = Clock::now();
+        ReplicateBuffer& buffer = buffers[index];
+        Resample(input_sequence, buffer.walk, buffer.matrix);
+        buffer.direct = config.format == AlignmentFormat::FASTA &&
+                        config.threads > 1 &&
+                        FASTASize(buffer.matrix.length(), taxa) >=
+                            PARALLEL_WRITE_BYTES;
+        if(buffer.direct){
+            buffer.alignment.clear();
+        }
+        else{
+            FormatAlignment(config.format, buffer.alignment, buffer.matrix, taxa,
+                            rows);
+        }
+        ostringstream walk_stream;
+        walk_stream << buffer.walk << '\n';
+        buffer.walk_text = walk_stream.str();
+        stats.busy_seconds += SecondsSince(start);
+        stats.items++;
+
+        if(!formatted.push(index)){
+            break;
+        }
+    }
+    formatted.close();
+}
+
+//Write a whole buffer to a file, throws if anything goes wrong
+static void WriteFile(const string& path, const string& contents){
+    ofstream file(path, std::ios::binary);
+    if(!file.is_open()){
+        throw std::runtime_error("Could not open \"" + path + "\" for writing");
+    }
+    file.write(contents.data(), contents.size());
+    if(!file){
+        throw std::runtime_error("Could not write to \"" + path + "\"");
+    }
+}
+
+void WriteReplicateFiles(const string& prefix, AlignmentFormat format,
+                         const string& alignment, const string& walk_text){
+    WriteFile(prefix + "." + FormatExtension(format), alignment);
+    WriteFile(prefix + ".walk", walk_text);
+}
+
+//What goes in front of file names to put them in the output directory
+static string DirectoryPrefix(const PipelineConfig& config){
+    if(config.directory.empty() || config.directory.back() == '/'){
+        return config.directory;
+    }
+    return config.directory + "/";
+}
+
+string ReplicatePrefix(const PipelineConfig& config, size_t trial_num){
+    return DirectoryPrefix(config) + "replicate-" + to_string(trial_num);
+}
+
+//Stage 3, write everything out and hand the buffer back to the generator
+static void WriteStage(const PipelineConfig& config, ManifestWriter* manifest,
+                       const vector<size_t>* rows, const vector<string>& taxa,
+                       vector<ReplicateBuffer>& buffers,
+                       BoundedQueue<size_t>& formatted,
+                       BoundedQueue<size_t>& free_buffers, StageStats& stats){
+    size_t index;
+    while(formatted.pop(index)){
+        Clock::time_point start = Clock::now();
+        const ReplicateBuffer& buffer = buffers[index];
+        string prefix = ReplicatePrefix(config, buffer.number);
+        if(buffer.direct){
+            string path = prefix + "." + FormatExtension(config.format);
+            WriteFASTAParallel(path, buffer.matrix, taxa, config.threads, rows);
+            WriteFile(prefix + ".walk", buffer.walk_text);
+            if(manifest != nullptr){
+                manifest->append_file(buffer.number, path, prefix + ".walk",
+                                      buffer.walk_text);
+            }
+        }
+        else{
+            WriteReplicateFiles(prefix, config.format, buffer.alignment,
+                                buffer.walk_text);
+            if(manifest != nullptr){
+                manifest->append(buffer.number,
+                                 prefix + "." + FormatExtension(config.format),
+                                 buffer.alignment, prefix + ".walk",
+                                 buffer.walk_text);
+            }
+        }
+        stats.busy_seconds += SecondsSince(start);
+        stats.items++;
+
+        free_buffers.push(index);
+    }
+}
+
+PipelineStats RunResamplePipeline(const PipelineConfig& config,
+                                  const CharMatrix& input_sequence,
+                                  const vector<string>& taxa){
+
+    PipelineStats result;
+    result.stages.resize(3);
+    result.stages[0].name = "generate";
+    result.stages[1].name = "resample";
+    result.stages[2].name = "write";
+
+    //Every buffer starts out free, the other queues can never hold more than
+    //the total number of buffers.
+    size_t depth = config.depth == 0 ? 1 : config.depth;
+    vector<ReplicateBuffer> buffers(depth);
+    BoundedQueue<size_t> free_buffers(depth);
+    BoundedQueue<size_t> generated(depth);
+    BoundedQueue<size_t> formatted(depth);
+    for(size_t i = 0; i < depth; i++){
+        free_buffers.push(i);
+    }
+
+    //Collapse identical rows before anything is resampled
+    Clock::time_point start = Clock::now();
+    CharMatrix unique;
+    vector<size_t> row_map;
+    bool collapsed = DeduplicateRows(input_sequence, unique, row_map);
+    const CharMatrix& source = collapsed ? unique : input_sequence;
+    result.rows = input_sequence.height();
+    result.unique_rows = source.height();
+
+    thread generator(GenerateStage, std::cref(config),
+                     input_sequence.length(), std::ref(buffers),
+                     std::ref(free_buffers), std::ref(generated),
+                     std::ref(result.stages[0]));
+    thread resampler(ResampleStage, std::cref(config), std::cref(source),
+                     collapsed ? &row_map : nullptr, std::cref(taxa),
+                     std::ref(buffers), std::ref(generated), std::ref(formatted),
+                     std::ref(result.stages[1]));
+
+    //The calling thread does the writing. If it fails, shut every queue so the
+    //other stages can finish before the error is passed on.
+    std::exception_ptr error;
+    try{
+        unique_ptr<ManifestWriter> manifest;
+        if(!config.manifest.empty()){
+            manifest.reset(new ManifestWriter(DirectoryPrefix(config) +
+                                              config.manifest));
+        }
+        WriteStage(config, manifest.get(), collapsed ? &row_map : nullptr, taxa,
+                   buffers, formatted, free_buffers, result.stages[2]);
+    }
+    catch(...){
+        error = std::current_exception();
+        free_buffers.close();
+        generated.close();
+        formatted.close();
+    }
+    generator.join();
+    resampler.join();
+    if(error){
+        std::rethrow_exception(error);
+    }
+
+    result.wall_seconds = SecondsSince(start);
+    return result;
+}
+
+ostream& operator<<(ostream& stream, const PipelineStats& stats){
+    stream << left << setw(10) << "stage" << setw(10) << "items"
+           << setw(12) << "busy (s)" << "utilization" << endl;
+    for(const StageStats& stage : stats.stages){
+        double utilization = 0;
+        if(stats.wall_seconds > 0){
+            utilization = 100.0 * stage.busy_seconds / stats.wall_seconds;
+        }
+        stream << left << setw(10) << stage.name << setw(10) << stage.items
+               << setw(12) << fixed << setprecision(3) << stage.busy_seconds
+               << setprecision(1) << utilization << '%' << endl;
+    }
+    stream << "rows: " << stats.rows << ", " << stats.unique_rows << " unique ("
+           << setprecision(2) << (stats.unique_rows == 0 ? 1.0 :
+                                  double(stats.rows) / stats.unique_rows)
+           << "x dedup ratio)" << endl;
+    stream << "wall time: " << setprecision(3) << stats.wall_seconds << "s"
+           << endl;
+    return stream;
+}
@@ -0,0 +1,91 @@
+/* The resampling pipeline splits the production of replicates into three
+ * stages which run concurrently:
+ *     1. generate - random walks are drawn, in replicate order
+ *     2. resample - each walk is applied to the input and formatted as text
+ *     3. write    - the formatted replicate and walk are written to disk
+ *
+ * Stages are connected by bounded queues and replicates travel through them in
+ * a fixed pool of reusable buffers, so memory use is bounded by the pipeline
+ * depth and not by the number of replicates.
+ *
+ * FASTA replicates of PARALLEL_WRITE_BYTES or more are not formatted in stage
+ * 2 when there are several threads. Stage 3 formats and writes them straight
+ * from the matrix on every thread instead, see output.hpp.
+ */
+
+#pragma once
+
+#include "sequence.hpp"
+#include "partition.hpp"
+#include "binary.hpp"
+#include "walk.hpp"
+#include "threadpool.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <string>
+#include <ostream>
+
+//How one stage of the pipeline spent its time. Busy time is time spent doing
+//actual work, everything else was spent blocked on a neighbouring stage.
+struct StageStats{
+    std::string name;
+    size_t items = 0;
+    double busy_seconds = 0;
+};
+
+//Timings for an entire pipeline run, and how many of the input's rows were
+//distinct (only those are resampled, see dedup.hpp).
+struct PipelineStats{
+    double wall_seconds = 0;
+    std::vector<StageStats> stages;
+    size_t rows = 0;
+    size_t unique_rows = 0;
+};
+
+//Prints a small table with the utilization of each stage, the stage closest to
+//100% is the bottleneck.
+std::ostream& operator<<(std::ostream&, const PipelineStats&);
+
+//Parameters shared by every replicate in a run.
+struct PipelineConfig{
+    uint64_t seed = 0;          //Every replicate's rng is derived from this
+    size_t first = 1;           //Number of the first replicate
+    size_t number = 1;          //How many replicates, numbered from first
+    std::vector<size_t> skip;   //Sorted numbers in the range not to produce
+    size_t length = 0;          //Length of each replicate
+    double bias = 0.01;         //Turnaround bias for the walks
+    size_t depth = 4;           //How many replicate buffers are in flight
+    std::vector<Partition> partitions;  //If not empty, walk each separately
+    size_t threads = 1;         //Threads drawing partition walks and writing
+                                //large replicates
+    AlignmentFormat format = AlignmentFormat::FASTA;  //Of the replicates
+    std::string manifest;       //If set, replicates are recorded in this file
+    std::string directory;      //Where files go, the working directory if empty
+};
+
+//Runs the pipeline, writing replicate-N.fasta (or .sba) and replicate-N.walk to
+//the configured directory. Replicate N's walk is drawn from ReplicateRNG(seed, N),
+//so any range of replicates matches the same range of a larger run. If a
+//manifest is given, each replicate is recorded in it once both of its files
+//are written (see manifest.hpp). Throws std::runtime_error if an output file
+//can't be written.
+PipelineStats RunResamplePipeline(const PipelineConfig& config,
+                                  const CharMatrix& input_sequence,
+                                  const std::vector<std::string>& taxa);
+
+//The walk of replicate number trial_num, exactly as RunResamplePipeline draws
+//it. Partitioned walks are drawn on the pool if one is given.
+RandomWalk DrawReplicateWalk(const PipelineConfig& config, size_t input_length,
+                             size_t trial_num, ThreadPool* pool = nullptr);
+
+//Where replicate number trial_num's files go, without the extension
+std::string ReplicatePrefix(const PipelineConfig& config, size_t trial_num);
+
+//Writes one replicate as <prefix>.<format extension> and <prefix>.walk from an
+//already formatted alignment and walk. Throws std::runtime_error if either file
+//can't be written.
+void WriteReplicateFiles(const std::string& prefix, AlignmentFormat format,
+                         const std::string& alignment,
+                         const std::string& walk_text);
@@ -0,0 +1,133 @@
+/* The protocol spoken between seres-daemon and its clients over a Unix domain
+ * socket. Like shm.hpp this header is self contained, so other programs can
+ * include it to talk to the daemon directly instead of going through
+ * seres-client.
+ *
+ * Every message is a frame: a uint32_t byte count in native byte order (client
+ * and daemon are always on the same node) followed by that many bytes. A client
+ * connects, sends one request frame of at most MAX_REQUEST_SIZE bytes and reads
+ * one response frame back, after which the daemon closes the connection.
+ *
+ * A request's first line holds the command and its arguments separated by
+ * tabs, the first argument is positional and the rest are key=value pairs.
+ * Anything after the first newline is the request body:
+ *
+ *     translate\t/data/replicate-1.walk\tmode=interval\n0:150,400:420
+ *
+ * A response starts with "ok\n" followed by the result, or "error\n" followed
+ * by a message. Paths are resolved by the daemon, so they should be absolute.
+ */
+
+#pragma once
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <stdexcept>
+
+//The socket used when none is given, in $XDG_RUNTIME_DIR if it is set and
+//otherwise in /tmp, named after the user's id.
+inline std::string DefaultSocketPath(){
+    const char* runtime_dir = std::getenv("XDG_RUNTIME_DIR");
+    if(runtime_dir != nullptr && runtime_dir[0] != '\0'){
+        return std::string(runtime_dir) + "/seres.sock";
+    }
+    return "/tmp/seres-" + std::to_string(getuid()) + ".sock";
+}
+
+//Fill a sockaddr_un for a path, throws std::runtime_error if it is too long
+inline sockaddr_un SocketAddress(const std::string& path){
+    sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if(path.size() >= sizeof(address.sun_path)){
+        throw std::runtime_error("The socket path \"" + path + "\" is too long");
+    }
+    std::memcpy(address.sun_path, path.data(), path.size());
+    return address;
+}
+
+//Read exactly size bytes. Returns false if the other end closed the connection
+//before the first byte, throws std::runtime_error if it closed part way.
+inline bool ReadFully(int fd, char* data, size_t size){
+    size_t done = 0;
+    while(done < size){
+        ssize_t result = read(fd, data + done, size - done);
+        if(result < 0 && errno == EINTR){
+            continue;
+        }
+        if(result < 0){
+            throw std::runtime_error(std::string("Could not read from the"
+                                     " socket: ") + std::strerror(errno));
+        }
+        if(result == 0){
+            if(done == 0){
+                return false;
+            }
+            throw std::runtime_error("The connection was closed mid message");
+        }
+        done += result;
+    }
+    return true;
+}
+
+//Write exactly size bytes, throws std::runtime_error on failure
+inline void WriteFully(int fd, const char* data, size_t size){
+    size_t done = 0;
+    while(done < size){
+        ssize_t result = write(fd, data + done, size - done);
+        if(result < 0 && errno == EINTR){
+            continue;
+        }
+        if(result <= 0){
+            throw std::runtime_error(std::string("Could not write to the"
+                                     " socket: ") + std::strerror(errno));
+        }
+        done += result;
+    }
+}
+
+//The largest request the daemon reads, so that a bad size can't make it
+//allocate gigabytes. Request bodies are lists of locations, far below this.
+const uint32_t MAX_REQUEST_SIZE = 64 << 20;
+
+//Thrown by ReadFrame for a frame larger than it was allowed to read
+class FrameTooLarge : public std::runtime_error{
+    public:
+        using std::runtime_error::runtime_error;
+};
+
+//Read one frame. Returns false if the connection was closed cleanly instead.
+//Throws FrameTooLarge without reading any of the frame if it is over max_size.
+inline bool ReadFrame(int fd, std::string& frame, uint32_t max_size = UINT32_MAX){
+    uint32_t size;
+    if(!ReadFully(fd, reinterpret_cast<char*>(&size), sizeof(size))){
+        return false;
+    }
+    if(size > max_size){
+        throw FrameTooLarge("A message of " + std::to_string(size) + " bytes is"
+                            " over the limit of " + std::to_string(max_size));
+    }
+    frame.resize(size);
+    if(size != 0 && !ReadFully(fd, &frame[0], size)){
+        throw std::runtime_error("The connection was closed mid message");
+    }
+    return true;
+}
+
+//Write one frame, throws std::runtime_error if it can't be sent
+inline void WriteFrame(int fd, const std::string& frame){
+    if(frame.size() > UINT32_MAX){
+        throw std::runtime_error("A message is too large to send");
+    }
+    uint32_t size = frame.size();
+    WriteFully(fd, reinterpret_cast<const char*>(&size), sizeof(size));
+    WriteFully(fd, frame.data(), frame.size());
+}
@@ -0,0 +1,138 @@
+#include "publish.hpp"
+#include "shm.hpp"
+#include "sequence.hpp"
+#include "walk.hpp"
+#include "resample.hpp"
+
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+using std::memcpy; using std::strerror;
+#include <stdexcept>
+using std::runtime_error;
+#include <string>
+using std::string;
+#include <vector>
+using std::vector;
+
+void PublishReplicates(const string& name, const CharMatrix& input,
+                       const vector<string>& taxa,
+                       const vector<RandomWalk>& walks,
+                       size_t first_replicate, bool materialize){
+
+    //Work out where every section goes before creating anything
+    size_t replicate_length = walks.empty() ? 0 : walks[0].length();
+    for(const RandomWalk& walk : walks){
+        if(walk.length() != replicate_length){
+            throw runtime_error("Published walks must all be the same length");
+        }
+    }
+    uint64_t taxa_size = 0;
+    for(const string& taxon : taxa){
+        taxa_size += taxon.size() + 1;
+    }
+    uint64_t total_segments = 0;
+    for(const RandomWalk& walk : walks){
+        total_segments += walk.size();
+    }
+
+    ShmHeader header;
+    memcpy(header.magic, SHM_MAGIC, sizeof(SHM_MAGIC));
+    header.version = SHM_VERSION;
+    header.flags = materialize ? SHM_HAS_REPLICATES : 0;
+    header.height = input.height();
+    header.length = input.length();
+    header.replicate_count = walks.size();
+    header.first_replicate = first_replicate;
+    header.replicate_length = replicate_length;
+    header.taxa_offset = ShmAlign(sizeof(ShmHeader));
+    header.input_offset = ShmAlign(header.taxa_offset + taxa_size);
+    header.walk_index_offset = 
+        ShmAlign(header.input_offset + input.height() * input.length());
+    header.segment_offset = ShmAlign(header.walk_index_offset + 
+                                     (walks.size() + 1) * sizeof(uint64_t));
+    uint64_t end = header.segment_offset + total_segments * sizeof(ShmSegment);
+    header.replicate_offset = 0;
+    if(materialize){
+        header.replicate_offset = ShmAlign(end);
+        end = header.replicate_offset + 
+              walks.size() * input.height() * replicate_length;
+    }
+    header.total_size = end;
+
+    //Create the object, sized to fit everything. An object already published
+    //under the name is unlinked rather than truncated, so consumers which
+    //still have it mapped keep its pages instead of faulting on them.
+    string path = name[0] == '/' ? name : "/" + name;
+    if(shm_unlink(path.c_str()) != 0 && errno != ENOENT){
+        throw runtime_error("Could not replace shared memory " + path + ": " +
+                            strerror(errno));
+    }
+    int fd = shm_open(path.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if(fd < 0){
+        throw runtime_error("Could not create shared memory " + path + ": " +
+                            strerror(errno));
+    }
+    if(ftruncate(fd, header.total_size) != 0){
+        close(fd);
+        throw runtime_error("Could not size shared memory " + path);
+    }
+    void* mapped = mmap(nullptr, header.total_size, PROT_READ | PROT_WRITE,
+                        MAP_SHARED, fd, 0);
+    close(fd);
+    if(mapped == MAP_FAILED){
+        throw runtime_error("Could not map shared memory " + path);
+    }
+    char* base = static_cast<char*>(mapped);
+
+    //Taxa names and the input matrix
+    char* name_cursor = base + header.taxa_offset;
+    for(const string& taxon : taxa){
+        memcpy(name_cursor, taxon.c_str(), taxon.size() + 1);
+        name_cursor += taxon.size() + 1;
+    }
+    for(size_t row_index = 0; row_index < input.height(); row_index++){
+        memcpy(base + header.input_offset + row_index * input.length(),
+               input.row(row_index), input.length());
+    }
+
+    //The walk index and segment table
+    uint64_t* walk_index = 
+        reinterpret_cast<uint64_t*>(base + header.walk_index_offset);
+    ShmSegment* segments = 
+        reinterpret_cast<ShmSegment*>(base + header.segment_offset);
+    uint64_t segment_count = 0;
+    for(size_t r = 0; r < walks.size(); r++){
+        walk_index[r] = segment_count;
+        for(const WalkSegment& ws : walks[r]){
+            ShmSegment& out = segments[segment_count++];
+            out.replicate_pos = ws.replicate_pos;
+            out.original_pos = ws.original_pos;
+            out.length = ws.length;
+            out.direction = ws.direction == Direction::Left ? 1 : 0;
+        }
+    }
+    walk_index[walks.size()] = segment_count;
+
+    //Optionally the replicates themselves, one matrix after another
+    if(materialize){
+        CharMatrix replicate;
+        size_t replicate_size = input.height() * replicate_length;
+        for(size_t r = 0; r < walks.size(); r++){
+            Resample(input, walks[r], replicate);
+            memcpy(base + header.replicate_offset + r * replicate_size,
+                   replicate.row(0), replicate_size);
+        }
+    }
+
+    //The header goes in last so readers never see a half written object
+    header.magic[0] = 0;
+    memcpy(base, &header, sizeof(ShmHeader));
+    __sync_synchronize();
+    memcpy(base, SHM_MAGIC, sizeof(SHM_MAGIC));
+    munmap(mapped, header.total_size);
+}
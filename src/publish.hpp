@@ -0,0 +1,26 @@
+/* Publishing of an input alignment and its random walks into POSIX shared
+ * memory, so that several processes on the same node can map them instead of
+ * each reading replicate files from disk. The layout is documented in shm.hpp,
+ * which is also the header consumers include to read it.
+ */
+
+#pragma once
+
+#include "sequence.hpp"
+#include "walk.hpp"
+
+#include <string>
+#include <vector>
+
+//Creates (or replaces) the shared memory object with the given name and fills
+//it with the input, its taxa and the walks, which are numbered from
+//first_replicate as they would be by seres-resample. If materialize is true the
+//replicates themselves are resampled into the object as well. The object is
+//left in place for consumers, remove it with shm_unlink or rm /dev/shm/<name>.
+//An object already published under the name is unlinked and a new one created,
+//so consumers holding the old one keep reading it until they unmap it.
+//Throws std::runtime_error if the object can't be created.
+void PublishReplicates(const std::string& name, const CharMatrix& input,
+                       const std::vector<std::string>& taxa,
+                       const std::vector<RandomWalk>& walks,
+                       size_t first_replicate, bool materialize);
@@ -0,0 +1,76 @@
+/* A small blocking queue with a fixed capacity, used to connect the stages of
+ * the resampling pipeline. Producers block while the queue is full and
+ * consumers block while it is empty, which bounds the amount of work in flight
+ * between two stages.
+ *
+ * Closing the queue wakes everyone up. After a close, pushes are refused and
+ * pops drain whatever is left before reporting that the queue is finished.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <utility>
+
+template <typename T>
+class BoundedQueue{
+    private:
+        std::deque<T> items_;
+        size_t capacity_;
+        bool closed_ = false;
+        std::mutex mutex_;
+        std::condition_variable not_empty_;
+        std::condition_variable not_full_;
+
+    public:
+
+        //A queue must hold at least one item, a capacity of 0 is bumped to 1.
+        explicit BoundedQueue(size_t capacity):
+            capacity_(capacity == 0 ? 1 : capacity){};
+
+        //Not copyable, the queue is shared between threads by reference.
+        BoundedQueue(const BoundedQueue&) = delete;
+        BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+        //Blocks until there is room for the item. Returns false if the queue
+        //was closed, in which case the item was not added.
+        bool push(T item){
+            std::unique_lock<std::mutex> lock(mutex_);
+            not_full_.wait(lock, [this]{
+                return closed_ || items_.size() < capacity_;
+            });
+            if(closed_){
+                return false;
+            }
+            items_.push_back(std::move(item));
+            not_empty_.notify_one();
+            return true;
+        }
+
+        //Blocks until an item is available. Returns false once the queue is
+        //closed and there is nothing left to hand out.
+        bool pop(T& item){
+            std::unique_lock<std::mutex> lock(mutex_);
+            not_empty_.wait(lock, [this]{
+                return closed_ || !items_.empty();
+            });
+            if(items_.empty()){
+                return false;
+            }
+            item = std::move(items_.front());
+            items_.pop_front();
+            not_full_.notify_one();
+            return true;
+        }
+
+        //Refuse any further pushes and wake up every waiting thread.
+        void close(){
+            std::lock_guard<std::mutex> lock(mutex_);
+            closed_ = true;
+            not_empty_.notify_all();
+            not_full_.notify_all();
+        }
+};
@@ -1,17 +1,30 @@
 #include "sequence.hpp"
 #include "walk.hpp"
 #include "resample.hpp"
+#include "kernels.hpp"
+#include <cstdint>
+#include <cstring>
+using std::memcpy;
+#include <algorithm>
+using std::min; using std::max;
 #include <stdexcept> 
 using std::out_of_range; 
 #include <utility>
 using std::make_pair;
 #include <random>
-using std::mt19937_64;
+using std::mt19937_64; using std::seed_seq;
 using std::uniform_int_distribution; using std::bernoulli_distribution;
 using std::geometric_distribution;
 #include <vector>
 using std::vector;
 
+mt19937_64 ReplicateRNG(uint64_t seed, uint64_t replicate, uint64_t stream){
+    seed_seq seq{uint32_t(seed), uint32_t(seed >> 32),
+                 uint32_t(replicate), uint32_t(replicate >> 32),
+                 uint32_t(stream), uint32_t(stream >> 32)};
+    return mt19937_64(seq);
+}
+
 //Convinience function which gives us a random direction, left or right with
 //equal probability.
 Direction RandomDirection(mt19937_64& rng){
@@ -108,9 +121,10 @@ RandomWalk LengthsToWalk(const vector<size_t>& lengths, size_t position,
 RandomWalk GenerateRandomWalk(size_t input_length, size_t output_length, 
                               double turnaround_bias, mt19937_64& rng){
 
-    //Generate a random starting position and direction
+    //Generate a random starting position and direction, the position has to
+    //be a real column or the first segment would read past the end.
     Direction start_direction = RandomDirection(rng);
-    uniform_int_distribution<size_t> start_dist(0, input_length);
+    uniform_int_distribution<size_t> start_dist(0, input_length - 1);
     size_t start_position = start_dist(rng);
 
     //Generate the vector of geometrically distributed lengths
@@ -122,47 +136,91 @@ RandomWalk GenerateRandomWalk(size_t input_length, size_t output_length,
                          start_direction, input_length);
 }
 
-//Convinience function which copies a column from one char matrix to another,
-//this is MEMORY UNSAFE and will fail in bad ways if you give it bad indicies!
-void CopyColumn(const CharMatrix& from, size_t from_col, 
-                      CharMatrix& to, size_t to_col){
-    for(size_t row_index = 0; row_index < to.height(); row_index++){
-        char c = from.get(row_index, from_col);
-        to.set(row_index, to_col, c);
+//Copies one walk segment of a single row. Segments running right are a plain
+//copy, segments running left are the same bytes back to front. This is MEMORY
+//UNSAFE and will fail in bad ways if you give it a segment outside the rows!
+static void CopyWalkSegment(const char* from_row, char* to_row,
+                            const WalkSegment& seg){
+    char* to = to_row + seg.replicate_pos;
+    if(seg.direction == Direction::Right){
+        memcpy(to, from_row + seg.original_pos, seg.length);
+    }
+    else{
+        ReverseCopy(to, from_row + seg.original_pos + 1 - seg.length, seg.length);
     }
 }
 
-//Function which accepts a filled in original matrix and an incomplete replicate
-//matrix. The function copies columns from the original to the replicate in
-//order to match the walk provided by the given ReplicateWalk object.
-void CopyWalkSegment(const CharMatrix& from, CharMatrix& to, 
-                     const WalkSegment& seg){
+//Build the replicate described by the walk from the input matrix
+CharMatrix Resample(const CharMatrix& input_matrix, const RandomWalk& walk){
+    CharMatrix output_matrix;
+    Resample(input_matrix, walk, output_matrix);
+    return output_matrix;
+}
 
-    size_t original_index = seg.original_pos;
-    size_t replicate_index = seg.replicate_pos;
-    for(size_t i = 0; i < seg.length; i++){
-        CopyColumn(from, original_index, to, replicate_index);
+//Fill an existing matrix, reallocating only if its shape is wrong
+void Resample(const CharMatrix& input_matrix, const RandomWalk& walk,
+              CharMatrix& output_matrix){
+    if(output_matrix.height() != input_matrix.height() ||
+       output_matrix.length() != walk.length()){
+        output_matrix = CharMatrix(input_matrix.height(), walk.length());
+    }
 
-        replicate_index++;
-        if(seg.direction == Direction::Right){
-            original_index++;
+    //Segments are unpacked from the walk a batch at a time, and every row
+    //gets the whole batch copied in before the next row. Each row is written
+    //front to back in whole segments, and the batch only has to be unpacked
+    //once rather than once per row.
+    const size_t batch_size = 4096;
+    vector<WalkSegment> batch;
+    batch.reserve(batch_size);
+    RandomWalk::const_iterator next = walk.begin();
+    while(next != walk.end()){
+        batch.clear();
+        for(; next != walk.end() && batch.size() < batch_size; ++next){
+            batch.push_back(*next);
         }
-        else{
-            original_index--; 
+        for(size_t row_index = 0; row_index < input_matrix.height(); row_index++){
+            const char* from_row = input_matrix.row(row_index);
+            char* to_row = output_matrix.row(row_index);
+            for(const WalkSegment& segment : batch){
+                CopyWalkSegment(from_row, to_row, segment);
+            }
         }
     }
 }
 
-//TODO comment
-CharMatrix Resample(const CharMatrix& input_matrix, const RandomWalk& walk){
-    //Allocate a new matrix
-    CharMatrix output_matrix(input_matrix.height(), walk.length());
-
-    //Iterate through all segments in order
-    for (WalkSegment segment: walk){
-       CopyWalkSegment(input_matrix, output_matrix, segment); 
+void ResampleFused(const CharMatrix& input_matrix,
+                   const vector<const RandomWalk*>& walks,
+                   const vector<CharMatrix*>& outputs){
+    vector<vector<WalkSegment>> segments(walks.size());
+    for(size_t k = 0; k < walks.size(); k++){
+        CharMatrix& output_matrix = *outputs[k];
+        if(output_matrix.height() != input_matrix.height() ||
+           output_matrix.length() != walks[k]->length()){
+            output_matrix = CharMatrix(input_matrix.height(), walks[k]->length());
+        }
+        segments[k].assign(walks[k]->begin(), walks[k]->end());
     }
 
-    return output_matrix;
+    //Within a band, rows are the inner loop as in Resample, so a batch of
+    //segments is reused by every row of the band while it is in cache too
+    const size_t batch_size = 4096;
+    size_t row_length = input_matrix.length() == 0 ? 1 : input_matrix.length();
+    size_t band_rows = max<size_t>(1, FUSED_BAND_BYTES / row_length);
+    for(size_t band = 0; band < input_matrix.height(); band += band_rows){
+        size_t band_end = min(band + band_rows, input_matrix.height());
+        for(size_t k = 0; k < walks.size(); k++){
+            const vector<WalkSegment>& walk_segments = segments[k];
+            for(size_t batch = 0; batch < walk_segments.size(); batch += batch_size){
+                size_t batch_end = min(batch + batch_size,
+                                            walk_segments.size());
+                for(size_t row_index = band; row_index < band_end; row_index++){
+                    const char* from_row = input_matrix.row(row_index);
+                    char* to_row = outputs[k]->row(row_index);
+                    for(size_t i = batch; i < batch_end; i++){
+                        CopyWalkSegment(from_row, to_row, walk_segments[i]);
+                    }
+                }
+            }
+        }
+    }
 }
-
@@ -3,8 +3,11 @@
 #include "sequence.hpp"
 #include "walk.hpp"
 
+#include <cstddef>
+#include <cstdint>
 #include <utility>
 #include <random>
+#include <vector>
 
 /* A resampling operation is defined entirely by a key. Thus the process of
  * resampling is devided into two steps.
@@ -13,7 +16,40 @@
  *     replicate alignment.
  */
 
+//The rng for one replicate, seeded from the run's seed and the replicate's
+//number alone. Any replicate can be drawn without drawing the ones before it,
+//so a run split into ranges produces exactly the same replicates as a single
+//run. Stream separates independent sets of replicates under one seed, such as
+//the loci of a batch run.
+std::mt19937_64 ReplicateRNG(uint64_t seed, uint64_t replicate,
+                             uint64_t stream = 0);
+
 RandomWalk GenerateRandomWalk(size_t input_length, size_t output_length, 
                               double turnaround_bias, std::mt19937_64& rng);
 
 CharMatrix Resample(const CharMatrix& input_matrix, const RandomWalk& walk);
+
+//Same as above but fills a caller owned matrix, which is only reallocated when
+//its dimensions don't already match. Lets a replicate buffer be reused.
+void Resample(const CharMatrix& input_matrix, const RandomWalk& walk,
+              CharMatrix& output_matrix);
+
+//How many bytes of input rows ResampleFused works on at a time, small enough
+//that a band stays in L2 while every walk is applied to it
+const size_t FUSED_BAND_BYTES = 256 << 10;
+
+//Apply several walks to one input at once, filling outputs[k] from walks[k]
+//exactly as Resample would, and reallocating outputs only when their shape is
+//wrong. The input is taken a band of rows at a time and every walk is applied
+//to a band before the next is touched, so each input row is read from memory
+//once for all of the walks instead of once per walk. The walks are unpacked up
+//front, which takes about 32 bytes per segment of each walk.
+//
+//This only pays off when the walks read most of every row. A walk turns
+//around at every segment, so it usually stays within a narrow window of the
+//input (a few percent of the columns at the default bias) and Resample is
+//bound by writing the replicate, not by reading the input. bench/fused.cpp
+//measures both, which is why the pipeline still uses Resample.
+void ResampleFused(const CharMatrix& input_matrix,
+                   const std::vector<const RandomWalk*>& walks,
+                   const std::vector<CharMatrix*>& outputs);
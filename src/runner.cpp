@@ -0,0 +1,302 @@
+#include "runner.hpp"
+#include "sequence.hpp"
+#include "walk.hpp"
+#include "resample.hpp"
+#include "pipeline.hpp"
+#include "binary.hpp"
+#include "dedup.hpp"
+
+#include <fcntl.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+using std::strerror;
+#include <algorithm>
+using std::sort;
+#include <atomic>
+using std::atomic;
+#include <chrono>
+#include <exception>
+#include <mutex>
+using std::mutex; using std::lock_guard;
+#include <thread>
+using std::thread;
+#include <stdexcept>
+using std::runtime_error;
+#include <sstream>
+using std::ostringstream;
+#include <iomanip>
+using std::fixed; using std::setprecision;
+#include <ostream>
+using std::ostream; using std::endl;
+#include <string>
+using std::string; using std::to_string;
+#include <vector>
+using std::vector;
+
+extern char** environ;
+
+typedef std::chrono::steady_clock Clock;
+
+//Seconds elapsed since a given time point
+static double SecondsSince(Clock::time_point start){
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+//Everything the jobs share
+struct RunnerState{
+    const PipelineConfig& config;
+    const vector<string>& command;
+    const CharMatrix& source;           //The input's unique rows
+    const vector<size_t>* rows;         //Maps them back out, if collapsed
+    const vector<string>& taxa;
+    size_t input_length;
+
+    atomic<size_t> next;                //The next replicate number to take
+    atomic<bool> stop;                  //Set once a job has hit an error
+    mutex stats_mutex;                  //Guards everything below
+    RunnerStats stats;
+    std::exception_ptr error;
+};
+
+//Starts the command with its stdin reading from input and its stdout going to
+//output. Every other descriptor is close on exec, so a command never holds on
+//to another job's pipe. SIGPIPE is ignored in this process but the command
+//gets the default back.
+static pid_t SpawnCommand(const vector<string>& command, size_t trial_num,
+                          int input, int output){
+    vector<char*> argv;
+    for(const string& argument : command){
+        argv.push_back(const_cast<char*>(argument.c_str()));
+    }
+    argv.push_back(nullptr);
+
+    string replicate = "SERES_REPLICATE=" + to_string(trial_num);
+    vector<char*> envp;
+    for(char** variable = environ; *variable != nullptr; variable++){
+        if(std::strncmp(*variable, "SERES_REPLICATE=", 16) != 0){
+            envp.push_back(*variable);
+        }
+    }
+    envp.push_back(const_cast<char*>(replicate.c_str()));
+    envp.push_back(nullptr);
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, input, STDIN_FILENO);
+    posix_spawn_file_actions_adddup2(&actions, output, STDOUT_FILENO);
+    posix_spawnattr_t attributes;
+    posix_spawnattr_init(&attributes);
+    sigset_t default_signals;
+    sigemptyset(&default_signals);
+    sigaddset(&default_signals, SIGPIPE);
+    posix_spawnattr_setsigdefault(&attributes, &default_signals);
+    posix_spawnattr_setflags(&attributes, POSIX_SPAWN_SETSIGDEF);
+
+    pid_t pid;
+    int result = posix_spawnp(&pid, argv[0], &actions, &attributes, argv.data(),
+                              envp.data());
+    posix_spawn_file_actions_destroy(&actions);
+    posix_spawnattr_destroy(&attributes);
+    if(result != 0){
+        throw runtime_error("Could not run \"" + command[0] + "\": " +
+                            strerror(result));
+    }
+    return pid;
+}
+
+//Write the replicate into the command's stdin. A command may stop reading
+//early, which isn't an error as far as feeding it goes.
+static void StreamInput(int fd, const string& data){
+    size_t done = 0;
+    while(done < data.size()){
+        ssize_t result = write(fd, data.data() + done, data.size() - done);
+        if(result < 0 && errno == EINTR){
+            continue;
+        }
+        if(result < 0 && errno == EPIPE){
+            return;
+        }
+        if(result <= 0){
+            throw runtime_error(string("Could not write to the command: ") +
+                                strerror(errno));
+        }
+        done += result;
+    }
+}
+
+//Write a whole file. It is opened close on exec like every other descriptor,
+//so that no command started meanwhile on another thread inherits it.
+static void WriteFile(const string& path, const string& data){
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+    if(fd < 0){
+        throw runtime_error("Could not open \"" + path + "\" for writing");
+    }
+    size_t done = 0;
+    while(done < data.size()){
+        ssize_t result = write(fd, data.data() + done, data.size() - done);
+        if(result < 0 && errno == EINTR){
+            continue;
+        }
+        if(result <= 0){
+            close(fd);
+            throw runtime_error("Could not write \"" + path + "\"");
+        }
+        done += result;
+    }
+    if(close(fd) != 0){
+        throw runtime_error("Could not write \"" + path + "\"");
+    }
+}
+
+//Draw, resample and run one replicate, returning whether the command
+//succeeded. The matrix and alignment are the job's own and are reused.
+static bool RunReplicate(RunnerState& state, size_t trial_num,
+                         CharMatrix& matrix, string& alignment,
+                         double& resample_seconds, double& command_seconds){
+    const PipelineConfig& config = state.config;
+    string prefix = ReplicatePrefix(config, trial_num);
+
+    Clock::time_point start = Clock::now();
+    RandomWalk walk = DrawReplicateWalk(config, state.input_length, trial_num);
+    Resample(state.source, walk, matrix);
+    FormatAlignment(config.format, alignment, matrix, state.taxa, state.rows);
+    ostringstream walk_text;
+    walk_text << walk << '\n';
+    WriteFile(prefix + ".walk", walk_text.str());
+    resample_seconds += SecondsSince(start);
+
+    start = Clock::now();
+    string output_path = prefix + ".out";
+    int output = open(output_path.c_str(),
+                      O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+    if(output < 0){
+        throw runtime_error("Could not open \"" + output_path + "\" for writing");
+    }
+    int pipe_fds[2];
+    if(pipe2(pipe_fds, O_CLOEXEC) != 0){
+        close(output);
+        throw runtime_error(string("Could not create a pipe: ") + strerror(errno));
+    }
+    pid_t pid;
+    try{
+        pid = SpawnCommand(state.command, trial_num, pipe_fds[0], output);
+    }
+    catch(...){
+        close(pipe_fds[0]);
+        close(pipe_fds[1]);
+        close(output);
+        throw;
+    }
+    close(pipe_fds[0]);
+    close(output);
+
+    //The command has to be waited for even if feeding it failed
+    std::exception_ptr error;
+    try{
+        StreamInput(pipe_fds[1], alignment);
+    }
+    catch(...){
+        error = std::current_exception();
+    }
+    close(pipe_fds[1]);
+    int status;
+    while(waitpid(pid, &status, 0) < 0 && errno == EINTR){}
+    command_seconds += SecondsSince(start);
+    if(error){
+        std::rethrow_exception(error);
+    }
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+//One job, taking replicate numbers until they run out or another job fails
+static void Job(RunnerState& state){
+    CharMatrix matrix;
+    string alignment;
+    double resample_seconds = 0, command_seconds = 0;
+    size_t last = state.config.first + state.config.number;
+    try{
+        while(!state.stop){
+            size_t trial_num = state.next++;
+            if(trial_num >= last){
+                break;
+            }
+            bool succeeded = RunReplicate(state, trial_num, matrix, alignment,
+                                          resample_seconds, command_seconds);
+            lock_guard<mutex> lock(state.stats_mutex);
+            state.stats.replicates++;
+            if(!succeeded){
+                state.stats.failed.push_back(trial_num);
+            }
+        }
+    }
+    catch(...){
+        lock_guard<mutex> lock(state.stats_mutex);
+        if(!state.error){
+            state.error = std::current_exception();
+        }
+        state.stop = true;
+    }
+    lock_guard<mutex> lock(state.stats_mutex);
+    state.stats.resample_seconds += resample_seconds;
+    state.stats.command_seconds += command_seconds;
+}
+
+RunnerStats RunCommandOnReplicates(const PipelineConfig& config,
+                                   const vector<string>& command,
+                                   const CharMatrix& input_sequence,
+                                   const vector<string>& taxa){
+    if(command.empty()){
+        throw runtime_error("No command to run");
+    }
+    Clock::time_point start = Clock::now();
+
+    //Identical rows are only resampled once, as in the pipeline
+    CharMatrix unique;
+    vector<size_t> row_map;
+    bool collapsed = DeduplicateRows(input_sequence, unique, row_map);
+
+    RunnerState state{config, command, collapsed ? unique : input_sequence,
+                      collapsed ? &row_map : nullptr, taxa,
+                      input_sequence.length()};
+    state.next = config.first;
+    state.stop = false;
+
+    //A command which exits without reading all of its input must not take
+    //the whole run down with SIGPIPE
+    signal(SIGPIPE, SIG_IGN);
+    size_t jobs = config.threads == 0 ? 1 : config.threads;
+    vector<thread> workers;
+    for(size_t i = 0; i < jobs; i++){
+        workers.emplace_back(Job, std::ref(state));
+    }
+    for(thread& worker : workers){
+        worker.join();
+    }
+    if(state.error){
+        std::rethrow_exception(state.error);
+    }
+
+    sort(state.stats.failed.begin(), state.stats.failed.end());
+    state.stats.wall_seconds = SecondsSince(start);
+    return state.stats;
+}
+
+ostream& operator<<(ostream& stream, const RunnerStats& stats){
+    stream << "replicates: " << stats.replicates << ", "
+           << stats.failed.size() << " failed" << endl;
+    stream << fixed << setprecision(3)
+           << "resampling: " << stats.resample_seconds << "s, commands: "
+           << stats.command_seconds << "s";
+    if(stats.wall_seconds > 0){
+        stream << setprecision(1) << " (" << (stats.resample_seconds +
+               stats.command_seconds) / stats.wall_seconds << " jobs busy)";
+    }
+    stream << endl << setprecision(3) << "wall time: " << stats.wall_seconds
+           << "s" << endl;
+    return stream;
+}
@@ -0,0 +1,48 @@
+/* Runs a command once per replicate with the replicate on its stdin, so an
+ * inference tool can be fed replicates without them ever being written to
+ * disk. This is what seres-run does.
+ *
+ * A fixed number of jobs run at once. Each job draws its replicate, resamples
+ * it, starts the command and streams the replicate into it, then waits for the
+ * command before taking the next replicate number. Replicates are only drawn
+ * by a job which is about to run the command on them, so no more than one
+ * replicate per job is ever held in memory, however slow the command is.
+ *
+ * Replicate N is identical to the one seres-resample writes with the same seed
+ * and parameters. The command's stdout goes to replicate-N.out next to
+ * replicate-N.walk, so results can be translated back with seres-translate
+ * afterwards, and its stderr is left alone. The command also finds N in the
+ * SERES_REPLICATE environment variable.
+ */
+
+#pragma once
+
+#include "sequence.hpp"
+#include "pipeline.hpp"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <ostream>
+
+//What happened over a whole run
+struct RunnerStats{
+    size_t replicates = 0;          //Commands which were run
+    std::vector<size_t> failed;     //Replicates whose command didn't exit 0
+    double wall_seconds = 0;
+    double resample_seconds = 0;    //Summed over the jobs
+    double command_seconds = 0;     //Likewise, including streaming the input
+};
+
+//A short summary, including how many jobs were kept busy on average
+std::ostream& operator<<(std::ostream&, const RunnerStats&);
+
+//Runs command (a program and its arguments, looked up on the PATH) on
+//replicates [first, first + number), with config.threads jobs at once. Output
+//files go to config.directory. Throws std::runtime_error if a file can't be
+//written or the command can't be started, after the jobs already running have
+//finished. A command exiting with an error is only recorded in the stats.
+RunnerStats RunCommandOnReplicates(const PipelineConfig& config,
+                                   const std::vector<std::string>& command,
+                                   const CharMatrix& input_sequence,
+                                   const std::vector<std::string>& taxa);
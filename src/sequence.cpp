@@ -1,5 +1,11 @@
 #include "sequence.hpp"
+#include "kernels.hpp"
+
+#include <sys/mman.h>
+
 #include <cstddef>
+#include <cstring>
+using std::memcpy;
 #include <algorithm>
 #include <stdexcept>
 #include <string>
@@ -17,9 +23,26 @@ CharMatrix::CharMatrix(size_t height, size_t length):
     block_ = new char[height * length];
 }
 
-//Destructor just frees the memory
+//Wrap a mapping, no memory is allocated or copied
+CharMatrix CharMatrix::FromMapping(void* mapping, size_t mapping_size,
+                                   size_t offset, size_t height, size_t length){
+    CharMatrix result;
+    result.height_ = height;
+    result.length_ = length;
+    result.block_ = static_cast<char*>(mapping) + offset;
+    result.mapping_ = mapping;
+    result.mapping_size_ = mapping_size;
+    return result;
+}
+
+//Destructor just frees the memory, or the mapping if there is one
 CharMatrix::~CharMatrix(){
-    delete[] block_;
+    if(mapping_ != nullptr){
+        munmap(mapping_, mapping_size_);
+    }
+    else{
+        delete[] block_;
+    }
 }
 
 //Copy constructor, uses std::copy to move memory around
@@ -63,67 +86,74 @@ const char& CharMatrix::at(size_t row_index, size_t col_index) const{
     return block_[row_index * length_ + col_index];
 }
 
+//Calls found(begin, end) for every line of the text which isn't blank, without
+//its newline. The last line doesn't need a newline.
+template<typename F>
+static void ForEachLine(const string& text, F found){
+    const char* end = text.data() + text.size();
+    for(const char* line = text.data(); line < end; ){
+        const char* newline = FindByte(line, end, '\n');
+        if(newline != line){
+            found(line, newline);
+        }
+        line = newline + 1;
+    }
+}
+
 //Read a FASTA formatted multiple sequence alignment from the provided istream
 //into the provided CharMatrix and taxa vector. This function will throw if the
 //provided sequences are not all the same length or if the number of taxa
 //provided does not match the number of names provided.
 void ReadFASTA(istream& stream, CharMatrix& matrix, vector<string>& taxa){
 
-    //Clear out the taxa vector and create a new vector for our sequences
-    taxa.clear();
-    vector<string> sequences;
+    //Slurp the whole stream, lines are then found in place without copying
+    string text;
+    char chunk[1 << 16];
+    while(stream.read(chunk, sizeof(chunk)) || stream.gcount() > 0){
+        text.append(chunk, stream.gcount());
+    }
 
-    //Read all lines from the input, skipping blank lines.
-    string line;
-    while(getline(stream, line)){
-        if(line.size() == 0){
-            continue;
+    //Stage 1, find every name and how long its sequence is
+    taxa.clear();
+    vector<size_t> lengths;
+    ForEachLine(text, [&taxa, &lengths](const char* begin, const char* end){
+        if(*begin == '>'){
+            taxa.push_back(string(begin + 1, end));
+            lengths.push_back(0);
         }
-
-        //If we find a taxa name...
-        if(line[0] == '>'){
-
-            //Add the name to the taxa vector
-            line.erase(0, 1); 
-            taxa.push_back(line);
-
-            //And add a new empty entry to our sequences, we know another
-            //sequence comes next
-            sequences.push_back("");
+        else if(lengths.empty()){
+            throw std::runtime_error("FASTA file not an alignment");
         }
-
-        //Otherwise, we add to the last sequence
         else{
-            sequences.back() += line;
+            lengths.back() += end - begin;
         }
-    }
-
-    //Check to make sure everything worked out
-    if(taxa.size() != sequences.size()){
-        throw std::runtime_error("FASTA file not an alignment");
-    }
+    });
 
     //Check to make sure all the sequences are the same length
-    for(size_t i = 1; i < sequences.size(); i++){
-        if(sequences[i].size() != sequences[i-1].size()){
+    for(size_t i = 1; i < lengths.size(); i++){
+        if(lengths[i] != lengths[i-1]){
             throw std::runtime_error("FASTA file not an alignment");
-        } 
+        }
     }
-    if(sequences[0].size() == 0){
+    if(lengths.empty() || lengths[0] == 0){
         throw std::runtime_error("FASTA file not an alignment");
     }
 
-    //Stage 2, create a CharMatrix with those rows, assign it to the matrix
-    //param.
-    size_t num_rows = sequences.size();
-    size_t num_cols = sequences[0].size();
-    matrix = CharMatrix(num_rows, num_cols);
-
-    for(size_t row_index=0; row_index<num_rows; row_index++){
-        for(size_t col_index=0; col_index<num_cols; col_index++){
-            matrix.set(row_index, col_index, sequences[row_index][col_index]);
+    //Stage 2, create a CharMatrix of the right size and copy every sequence
+    //line straight into its row
+    matrix = CharMatrix(lengths.size(), lengths[0]);
+    char* row = nullptr;
+    size_t row_index = 0;
+    ForEachLine(text, [&matrix, &row, &row_index](const char* begin,
+                                                  const char* end){
+        if(*begin == '>'){
+            row = matrix.row(row_index++);
         }
-    }
+        else{
+            memcpy(row, begin, end - begin);
+            row += end - begin;
+        }
+    });
 }
 
 //Write a FASTA formatted multiple sequence alignmet to the provided ostream
@@ -149,9 +179,37 @@ void WriteFASTA(ostream& stream, const CharMatrix& matrix,
         stream << '>' << taxa.at(row_index) << endl; 
 
         //Then write out the contents of the row on the next line
-        for(size_t col_index = 0; col_index < num_cols; col_index++){
-            stream << matrix.get(row_index, col_index);
-        }
+        stream.write(matrix.row(row_index), num_cols);
         stream << endl;
     }
 }
+
+//Format a FASTA alignment into the provided buffer, the output matches
+//WriteFASTA byte for byte. Throws if taxa.size() != matrix.height()
+void FormatFASTA(string& buffer, const CharMatrix& matrix, 
+                 const vector<string>& taxa, const vector<size_t>* rows){
+
+    size_t num_rows = rows == nullptr ? matrix.height() : rows->size();
+    size_t num_cols = matrix.length();
+    if(num_rows != taxa.size()){
+        throw std::runtime_error("Number of taxa does not match the alignment");
+    }
+
+    //Work out the final size first so the buffer only grows once
+    size_t total = 0;
+    for(const string& name : taxa){
+        total += name.size() + num_cols + 3;
+    }
+    buffer.clear();
+    buffer.reserve(total);
+
+    //Then append each name line followed by the row itself
+    for(size_t row_index=0; row_index < num_rows; row_index++){
+        buffer += '>';
+        buffer += taxa[row_index];
+        buffer += '\n';
+        size_t source = rows == nullptr ? row_index : (*rows)[row_index];
+        buffer.append(matrix.row(source), num_cols);
+        buffer += '\n';
+    }
+}
@@ -16,6 +16,11 @@ class CharMatrix{
         size_t length_ = 0;          //The # of cols
         char* block_ = nullptr;      //Pointer to memory with data. 
 
+        //If the data lives in a memory mapping rather than on the heap, the
+        //whole mapping, which is released instead of block_.
+        void* mapping_ = nullptr;
+        size_t mapping_size_ = 0;
+
     public:
 
         //Default constructor allowed and safe, second constructor just
@@ -23,6 +28,12 @@ class CharMatrix{
         CharMatrix() = default;
         CharMatrix(size_t height, size_t length);
 
+        //Takes ownership of a private (copy on write) memory mapping whose
+        //row-major data starts offset bytes in. The mapping is unmapped when
+        //the matrix is destroyed, copies of the matrix live on the heap.
+        static CharMatrix FromMapping(void* mapping, size_t mapping_size,
+                                      size_t offset, size_t height, size_t length);
+
         //This object uses the copy swap idiom
         ~CharMatrix();
         CharMatrix(const CharMatrix& other);
@@ -33,6 +44,8 @@ class CharMatrix{
             swap(first.height_, second.height_);
             swap(first.length_, second.length_);
             swap(first.block_, second.block_);
+            swap(first.mapping_, second.mapping_);
+            swap(first.mapping_size_, second.mapping_size_);
         }
         
         //Getters for the dimentions of the matrix, inline.
@@ -45,6 +58,11 @@ class CharMatrix{
         char get(size_t row_index, size_t col_index) const;
         void set(size_t row_index, size_t col_index, char c);
 
+        //Raw pointers to the start of a row, the row is length() chars long
+        //and is not null terminated. Not memory safe either.
+              char* row(size_t row_index)      {return block_ + row_index * length_;};
+        const char* row(size_t row_index) const{return block_ + row_index * length_;};
+
         //Methods which return references to a particular scored character, two
         //versions for const and non-const access.
         //These are memory safe and will throw an exception if used improperly.
@@ -58,3 +76,10 @@ class CharMatrix{
 //parsing or writing fails. 
 void ReadFASTA(std::istream&, CharMatrix&, std::vector<std::string>&);
 void WriteFASTA(std::ostream&, const CharMatrix&, const std::vector<std::string>&);
+
+//Formats the same text WriteFASTA would produce into a string buffer, replacing
+//its contents. Reusing one buffer across calls avoids reallocating it. If rows
+//is given, the output's row i is the matrix's row (*rows)[i], which lets a
+//matrix of unique rows be written out with all of its duplicates.
+void FormatFASTA(std::string&, const CharMatrix&, const std::vector<std::string>&,
+                 const std::vector<size_t>* rows = nullptr);
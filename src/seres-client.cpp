@@ -0,0 +1,168 @@
+#include "protocol.hpp"
+
+#include <getopt.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+using std::strerror;
+#include <iostream>
+using std::cout; using std::cerr; using std::cin; using std::endl;
+using std::istream;
+#include <fstream>
+using std::ifstream;
+#include <string>
+using std::string;
+#include <iterator>
+using std::istreambuf_iterator;
+#include <stdexcept>
+
+string usage =
+"USAGE:\n"
+"  seres-client [OPTIONS] <command> [<path>] [<key>=<value>]...\n\n"
+"Sends one request to a running seres-daemon and writes the result to stdout.\n"
+"Relative paths are made absolute before they are sent. For example:\n\n"
+"  seres-client resample alignment.fasta seed=42 range=7 > replicate-7.fasta\n"
+"  seres-client resample alignment.fasta seed=42 range=1:1000 dir=replicates\n"
+"  echo 0:150,400:420 | seres-client translate replicate-1.walk mode=interval\n"
+"  seres-client coverage alignment.fasta seed=42 range=1:1000 bias=0.001\n\n"
+"See src/daemon.hpp for every command and option.\n\n"
+"FLAGS:\n"
+"  -h, --help              Display this message.\n\n"
+"OPTIONS:\n"
+"  -S, --socket <path>     The daemon's socket, with the same default as\n"
+"                          seres-daemon.\n"
+"  -f, --file <file>       Send the file as the request body. Otherwise the\n"
+"                          body of a translate request is read from stdin.\n"
+;
+
+//Make a path absolute against the working directory
+static string Absolute(const string& path){
+    if(path.empty() || path[0] == '/'){
+        return path;
+    }
+    char* cwd = getcwd(nullptr, 0);
+    if(cwd == nullptr){
+        return path;
+    }
+    string result = string(cwd) + "/" + path;
+    free(cwd);
+    return result;
+}
+
+int main(int argc, char* argv[]){
+
+    //Define the options for GNU getopt_long. The + stops at the command, so
+    //the request's own arguments are passed on untouched.
+    char c;
+    extern char* optarg;
+    extern int optind;
+    const char* const shortopts = "+hS:f:";
+    const option longopts[] = {
+        {"help", no_argument, nullptr, 'h'},
+        {"socket", required_argument, nullptr, 'S'},
+        {"file", required_argument, nullptr, 'f'},
+        {nullptr, 0, nullptr, 0}
+    };
+
+    //Options
+    bool Sflag = false;
+    string Sarg;
+    bool fflag = false;
+    string farg;
+
+    //Run getopt long to parse and grab these
+    while((c = getopt_long(argc, argv, shortopts, longopts, nullptr)) != -1){
+        switch(c){
+            case 'S':
+                Sflag = true;
+                Sarg.assign(optarg);
+                break;
+            case 'f':
+                fflag = true;
+                farg.assign(optarg);
+                break;
+            case 'h':
+                cerr << usage << endl;
+                exit(0);
+                break;
+            case '?':
+                cerr << usage << endl;
+                exit(1);
+                break;
+        }
+    }
+    if(optind == argc){
+        cerr << "Error! A command must be supplied." << endl << endl;
+        cerr << usage << endl;
+        exit(1);
+    }
+
+    //Build the first line of the request. Paths are resolved by the daemon, so
+    //anything which names a file is made absolute here.
+    string command = argv[optind];
+    string request = command;
+    for(int i = optind + 1; i < argc; i++){
+        string argument = argv[i];
+        if(i == optind + 1 && argument.find('=') == string::npos){
+            argument = Absolute(argument);
+        }
+        else if(argument.compare(0, 4, "dir=") == 0){
+            argument = "dir=" + Absolute(argument.substr(4));
+        }
+        request += '\t' + argument;
+    }
+    request += '\n';
+
+    //And the body, if there is one
+    if(fflag){
+        ifstream body_file(farg, std::ios::binary);
+        if(!body_file.is_open()){
+            cerr << "Error! Could not open the file \"" << farg << "\"" << endl;
+            exit(1);
+        }
+        request.append(istreambuf_iterator<char>(body_file),
+                       istreambuf_iterator<char>());
+    }
+    else if(command == "translate"){
+        request.append(istreambuf_iterator<char>(cin), istreambuf_iterator<char>());
+    }
+
+    //Send it and wait for the answer
+    if(request.size() > MAX_REQUEST_SIZE){
+        cerr << "Error! The request is " << request.size() << " bytes, over the"
+                " daemon's limit of " << MAX_REQUEST_SIZE << "." << endl;
+        exit(1);
+    }
+    string path = Sflag ? Sarg : DefaultSocketPath();
+    string response;
+    try{
+        sockaddr_un address = SocketAddress(path);
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if(fd < 0 || connect(fd, reinterpret_cast<sockaddr*>(&address),
+                             sizeof(address)) != 0){
+            throw std::runtime_error("Could not connect to a daemon at \"" +
+                                     path + "\": " + strerror(errno));
+        }
+        WriteFrame(fd, request);
+        if(!ReadFrame(fd, response)){
+            throw std::runtime_error("The daemon closed the connection");
+        }
+        close(fd);
+    }
+    catch (std::runtime_error& e){
+        cerr << "Error! " << e.what() << endl;
+        exit(1);
+    }
+
+    size_t newline = response.find('\n');
+    string status = response.substr(0, newline);
+    string result = newline == string::npos ? "" : response.substr(newline + 1);
+    if(status != "ok"){
+        cerr << "Error! " << result << endl;
+        exit(1);
+    }
+    cout.write(result.data(), result.size());
+}
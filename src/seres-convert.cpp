@@ -0,0 +1,150 @@
+#include "sequence.hpp"
+#include "binary.hpp"
+
+#include <getopt.h>
+
+#include <iostream>
+using std::cerr; using std::endl;
+#include <fstream>
+using std::ifstream; using std::ofstream;
+#include <string>
+using std::string;
+#include <vector>
+using std::vector;
+#include <stdexcept>
+
+string usage =
+"USAGE:\n"
+"  seres-convert [OPTIONS] <input alignment> <output alignment>\n\n"
+"Converts alignments between FASTA and the binary format (see src/binary.hpp).\n"
+"The format of the input is detected automatically.\n\n"
+"FLAGS:\n"
+"  -h, --help              Display this message.\n"
+"  -c, --column-major      Store a binary output column by column.\n\n"
+"OPTIONS:\n"
+"  -F, --format <format>   Format of the output, fasta or binary. Defaults to\n"
+"                          binary for a FASTA input and FASTA for a binary one.\n"
+;
+
+int main(int argc, char* argv[]){
+
+    //Define the options for GNU getopt_long
+    char c;
+    extern char* optarg;
+    extern int optind;
+    const char* const shortopts = "hcF:";
+    const option longopts[] = {
+        {"help", no_argument, nullptr, 'h'},
+        {"column-major", no_argument, nullptr, 'c'},
+        {"format", required_argument, nullptr, 'F'},
+        {nullptr, 0, nullptr, 0}
+    };
+
+    //Flags
+    bool cflag = false;
+
+    //Options
+    bool Fflag = false;
+    string Farg;
+
+    //Run getopt long to parse and grab these
+    while((c = getopt_long(argc, argv, shortopts, longopts, nullptr)) != -1){
+        switch(c){
+            case 'c':
+                cflag = true;
+                break;
+            case 'F':
+                Fflag = true;
+                Farg.assign(optarg);
+                break;
+            case 'h':
+                cerr << usage << endl;
+                exit(0);
+                break;
+            case '?':
+                cerr << usage << endl;
+                exit(1);
+                break;
+        }
+    }
+
+    //Calculate the number of positional args, there must be an input and an
+    //output.
+    int num_positional_args = argc - optind;
+    if(num_positional_args != 2){
+        cerr << "Error! Exactly two positional args must be supplied but "
+             << num_positional_args << " were found." << endl << endl;
+        cerr << usage << endl;
+        exit(1);
+    }
+    string input_path = argv[optind];
+    string output_path = argv[optind + 1];
+
+    //Read the input in whichever format it is in
+    CharMatrix matrix;
+    vector<string> taxa;
+    try{
+        ReadAlignmentFile(input_path, matrix, taxa);
+    }
+    catch (std::runtime_error& e){
+        cerr << "Error! The input \"" << input_path
+             << "\" could not be read as an alignment." << endl;
+        exit(1);
+    }
+
+    //Work out the output format, the opposite of the input by default
+    AlignmentFormat format;
+    if(Fflag){
+        if(Farg == "binary"){
+            format = AlignmentFormat::Binary;
+        }
+        else if(Farg == "fasta"){
+            format = AlignmentFormat::FASTA;
+        }
+        else{
+            cerr << "Error! The format arg \"" << Farg << "\" must be either"
+                    " fasta or binary." << endl << endl;
+            cerr << usage << endl;
+            exit(1);
+        }
+    }
+    else{
+        ifstream input(input_path, std::ios::binary);
+        char magic[sizeof(BINARY_MAGIC)] = {0};
+        input.read(magic, sizeof(magic));
+        bool binary_input = string(magic, sizeof(magic)) ==
+                            string(BINARY_MAGIC, sizeof(BINARY_MAGIC));
+        format = binary_input ? AlignmentFormat::FASTA : AlignmentFormat::Binary;
+    }
+    if(cflag && format != AlignmentFormat::Binary){
+        cerr << "Error! --column-major only applies to binary output." << endl;
+        exit(1);
+    }
+
+    //And write it out
+    ofstream output(output_path, std::ios::binary);
+    if(!output.is_open()){
+        cerr << "Error! The output \"" << output_path
+             << "\" could not be opened for writing." << endl;
+        exit(1);
+    }
+    try{
+        if(format == AlignmentFormat::Binary){
+            WriteBinaryAlignment(output, matrix, taxa, cflag ?
+                MatrixLayout::ColumnMajor : MatrixLayout::RowMajor);
+        }
+        else{
+            string buffer;
+            FormatFASTA(buffer, matrix, taxa);
+            output.write(buffer.data(), buffer.size());
+        }
+    }
+    catch (std::runtime_error& e){
+        cerr << "Error! " << e.what() << endl;
+        exit(1);
+    }
+    if(!output){
+        cerr << "Error! Could not write to \"" << output_path << "\"." << endl;
+        exit(1);
+    }
+}
@@ -0,0 +1,193 @@
+#include "daemon.hpp"
+#include "protocol.hpp"
+#include "threadpool.hpp"
+
+#include <getopt.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+using std::strerror;
+#include <iostream>
+using std::cerr; using std::endl;
+#include <string>
+using std::string;
+#include <stdexcept>
+
+string usage =
+"USAGE:\n"
+"  seres-daemon [OPTIONS]\n\n"
+"Keeps alignments and walks loaded in memory and serves resample, translate\n"
+"and coverage requests over a Unix domain socket, see src/daemon.hpp for the\n"
+"commands and src/protocol.hpp for the protocol. Use seres-client to send it\n"
+"requests. Runs in the foreground until it is interrupted.\n\n"
+"FLAGS:\n"
+"  -h, --help              Display this message.\n\n"
+"OPTIONS:\n"
+"  -S, --socket <path>     The socket to listen on. Defaults to seres.sock in\n"
+"                          $XDG_RUNTIME_DIR, or /tmp/seres-<uid>.sock.\n"
+"  -j, --threads <num>     How many clients are served at once, further\n"
+"                          clients wait for a free thread.\n"
+"                          Defaults to the number of cores.\n"
+;
+
+//The socket path, kept where the signal handler can reach it
+static char socket_path[sizeof(sockaddr_un::sun_path)];
+
+//Remove the socket on the way out so the next daemon can bind it
+static void Shutdown(int){
+    unlink(socket_path);
+    _exit(0);
+}
+
+//How long a client may take to send its request before it is dropped
+const time_t RECEIVE_TIMEOUT_SECONDS = 10;
+
+//Serve a client's one request. Connections are closed after it, and dropped if
+//it doesn't arrive in time, so no client can hold on to a pool thread.
+static void ServeConnection(Daemon& daemon, int fd){
+    timeval timeout = {RECEIVE_TIMEOUT_SECONDS, 0};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    try{
+        string request;
+        try{
+            if(ReadFrame(fd, request, MAX_REQUEST_SIZE)){
+                WriteFrame(fd, daemon.handle(request));
+            }
+        }
+        catch(FrameTooLarge& e){
+            WriteFrame(fd, string("error\n") + e.what());
+        }
+    }
+    catch(std::runtime_error& e){
+        //The client went away or timed out mid request, nothing else to do
+    }
+    close(fd);
+}
+
+int main(int argc, char* argv[]){
+
+    //Define the options for GNU getopt_long
+    char c;
+    extern char* optarg;
+    extern int optind;
+    const char* const shortopts = "hS:j:";
+    const option longopts[] = {
+        {"help", no_argument, nullptr, 'h'},
+        {"socket", required_argument, nullptr, 'S'},
+        {"threads", required_argument, nullptr, 'j'},
+        {nullptr, 0, nullptr, 0}
+    };
+
+    //Options
+    bool Sflag = false;
+    string Sarg;
+    bool jflag = false;
+    string jarg;
+
+    //Run getopt long to parse and grab these
+    while((c = getopt_long(argc, argv, shortopts, longopts, nullptr)) != -1){
+        switch(c){
+            case 'S':
+                Sflag = true;
+                Sarg.assign(optarg);
+                break;
+            case 'j':
+                jflag = true;
+                jarg.assign(optarg);
+                break;
+            case 'h':
+                cerr << usage << endl;
+                exit(0);
+                break;
+            case '?':
+                cerr << usage << endl;
+                exit(1);
+                break;
+        }
+    }
+    if(optind != argc){
+        cerr << "Error! seres-daemon doesn't take any positional args."
+             << endl << endl;
+        cerr << usage << endl;
+        exit(1);
+    }
+
+    //Deal with the number of threads
+    size_t threads = ThreadPool::default_threads();    //Default value
+    if(jflag){
+        try{
+            threads = stoul(jarg);
+        }
+        catch (std::invalid_argument& e){
+            cerr << "Error! The threads arg \"" << jarg << "\", "  << endl;
+            cerr << "could not be converted to an non-negative integer value.";
+            cerr << endl << endl;
+            cerr << usage << endl;
+            exit(1);
+        }
+    }
+
+    //Set up the socket. If one is already there, only replace it if nothing
+    //is listening on it any more.
+    string path = Sflag ? Sarg : DefaultSocketPath();
+    sockaddr_un address;
+    try{
+        address = SocketAddress(path);
+    }
+    catch (std::runtime_error& e){
+        cerr << "Error! " << e.what() << endl;
+        exit(1);
+    }
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if(listener < 0){
+        cerr << "Error! Could not create a socket: " << strerror(errno) << endl;
+        exit(1);
+    }
+    if(connect(listener, reinterpret_cast<sockaddr*>(&address),
+               sizeof(address)) == 0){
+        cerr << "Error! A daemon is already listening on \"" << path << "\"."
+             << endl;
+        exit(1);
+    }
+    close(listener);
+    unlink(path.c_str());
+    listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if(listener < 0 ||
+       bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+       listen(listener, 128) != 0){
+        cerr << "Error! Could not listen on \"" << path << "\": "
+             << strerror(errno) << endl;
+        exit(1);
+    }
+
+    //Clients hanging up shouldn't kill the daemon, interrupting it should
+    //clean up the socket.
+    std::strncpy(socket_path, path.c_str(), sizeof(socket_path) - 1);
+    signal(SIGPIPE, SIG_IGN);
+    signal(SIGINT, Shutdown);
+    signal(SIGTERM, Shutdown);
+
+    //Every connection's request is served on the pool
+    Daemon daemon;
+    ThreadPool pool(threads);
+    while(true){
+        int fd = accept(listener, nullptr, nullptr);
+        if(fd < 0){
+            if(errno == EINTR || errno == ECONNABORTED){
+                continue;
+            }
+            cerr << "Error! Could not accept a connection: " << strerror(errno)
+                 << endl;
+            Shutdown(0);
+        }
+        Daemon* daemon_ptr = &daemon;
+        pool.submit([daemon_ptr, fd]{
+            ServeConnection(*daemon_ptr, fd);
+        });
+    }
+}
@@ -0,0 +1,213 @@
+#include "walk.hpp"
+#include "translate.hpp"
+#include "index.hpp"
+
+#include <getopt.h>
+
+#include <iostream>
+using std::cout; using std::cerr; using std::cin; using std::endl;
+#include <fstream>
+using std::ifstream;
+#include <string>
+using std::string; using std::getline; using std::to_string;
+#include <vector>
+using std::vector;
+#include <stdexcept>
+
+string usage =
+"USAGE:\n"
+"  seres-index [OPTIONS] -o <index> <walk file>...\n"
+"  seres-index [OPTIONS] -q <index>\n\n"
+"Builds an inverse index over a set of walks, or uses one to find where\n"
+"original sites ended up in every replicate.\n\n"
+"FLAGS:\n"
+"  -h, --help              Display this message.\n\n"
+"OPTIONS:\n"
+"  -o, --output <index>    Build an index over the walk files and save it here.\n"
+"  -L, --length <length>   When building, the length of the original alignment.\n"
+"                          Defaults to just past the furthest site visited.\n"
+"  -q, --query <index>     Look up original sites in a saved index. Each site\n"
+"                          gets a line listing walk:position pairs, with walks\n"
+"                          numbered from 1 in the order they were indexed.\n"
+"  -f, --file <file>       Read query sites from a file rather than stdin.\n"
+"  -s, --sep <separator>   Separator for query sites, default is ','\n\n"
+"ARGS:\n"
+"  <walk file>             Walk files produced by seres-resample.\n"
+;
+
+//Look up every site and write one line per site to stdout
+void QueryIndex(const InverseIndex& index, const vector<size_t>& sites){
+    string buffer;
+    for(size_t site : sites){
+        if(site >= index.original_length()){
+            throw std::out_of_range("Site " + to_string(site) +
+                                    " is past the end of the original");
+        }
+        buffer += to_string(site);
+        buffer += '\t';
+        for(const IndexEntry* entry = index.begin(site);
+            entry != index.end(site); entry++){
+            if(entry != index.begin(site)){
+                buffer += ' ';
+            }
+            buffer += to_string(entry->walk + 1);
+            buffer += ':';
+            buffer += to_string(entry->replicate_pos);
+        }
+        buffer += '\n';
+    }
+    cout << buffer;
+}
+
+int main(int argc, char* argv[]){
+
+    //Define the options for GNU getopt_long
+    char c;
+    extern char* optarg;
+    extern int optind;
+    const char* const shortopts = "ho:L:q:f:s:";
+    const option longopts[] = {
+        {"help", no_argument, nullptr, 'h'},
+        {"output", required_argument, nullptr, 'o'},
+        {"length", required_argument, nullptr, 'L'},
+        {"query", required_argument, nullptr, 'q'},
+        {"file", required_argument, nullptr, 'f'},
+        {"sep", required_argument, nullptr, 's'},
+        {nullptr, 0, nullptr, 0}
+    };
+
+    //Options
+    bool oflag = false;
+    string oarg;
+    bool Lflag = false;
+    string Larg;
+    bool qflag = false;
+    string qarg;
+    bool fflag = false;
+    string farg;
+    bool sflag = false;
+    string sarg;
+
+    //Run getopt long to parse and grab these
+    while((c = getopt_long(argc, argv, shortopts, longopts, nullptr)) != -1){
+        switch(c){
+            case 'o':
+                oflag = true;
+                oarg.assign(optarg);
+                break;
+            case 'L':
+                Lflag = true;
+                Larg.assign(optarg);
+                break;
+            case 'q':
+                qflag = true;
+                qarg.assign(optarg);
+                break;
+            case 'f':
+                fflag = true;
+                farg.assign(optarg);
+                break;
+            case 's':
+                sflag = true;
+                sarg.assign(optarg);
+                break;
+            case 'h':
+                cerr << usage << endl;
+                exit(0);
+                break;
+            case '?':
+                cerr << usage << endl;
+                exit(1);
+                break;
+        }
+    }
+
+    //Exactly one of building or querying
+    if(oflag == qflag){
+        cerr << "Error! Exactly one of -o and -q must be given." << endl << endl;
+        cerr << usage << endl;
+        exit(1);
+    }
+
+    //Building, read every walk and index them in order
+    if(oflag){
+        if(optind == argc){
+            cerr << "Error! At least one walk file must be supplied."
+                 << endl << endl;
+            cerr << usage << endl;
+            exit(1);
+        }
+
+        size_t length = 0;
+        if(Lflag){
+            try{
+                length = stoul(Larg);
+            }
+            catch (std::invalid_argument& e){
+                cerr << "Error! The length arg \"" << Larg << "\", "  << endl;
+                cerr << "could not be converted to an non-negative integer value.";
+                cerr << endl << endl;
+                cerr << usage << endl;
+                exit(1);
+            }
+        }
+
+        vector<RandomWalk> walks;
+        for(int i = optind; i < argc; i++){
+            try{
+                walks.push_back(ReadWalkFile(argv[i]));
+            }
+            catch (std::runtime_error& e){
+                cerr << "Error! Walk " << i - optind + 1 << ": " << e.what() << endl;
+                exit(1);
+            }
+        }
+
+        try{
+            InverseIndex::Build(walks, length).save(oarg);
+        }
+        catch (std::runtime_error& e){
+            cerr << "Error! " << e.what() << endl;
+            exit(1);
+        }
+        return 0;
+    }
+
+    //Querying, map the index and look up every site we're given
+    char sep = ',';
+    if(sflag && sarg.length() == 1){
+        sep = sarg[0];
+    }
+
+    vector<size_t> sites;
+    try{
+        if(fflag){
+            ifstream ifs(farg);
+            if(!ifs.is_open()){
+                cerr << "Error! Could not open the file \"" << farg << "\""
+                     << endl;
+                cerr << "Check to make sure it exists and you have permisstions."
+                     << endl << endl;
+                cerr << usage << endl;
+                exit(1);
+            }
+            sites = ReadLocations(ifs, sep);
+        }
+        else{
+            sites = ReadLocations(cin, sep);
+        }
+    }
+    catch (std::logic_error& e){
+        cerr << "Error! The query sites must be non-negative integers separated"
+                " by '" << sep << "'." << endl;
+        exit(1);
+    }
+
+    try{
+        QueryIndex(InverseIndex::Map(qarg), sites);
+    }
+    catch (std::exception& e){
+        cerr << "Error! " << e.what() << endl;
+        exit(1);
+    }
+}
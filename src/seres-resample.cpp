@@ -1,6 +1,16 @@
 #include "sequence.hpp"
 #include "walk.hpp"
 #include "resample.hpp"
+#include "pipeline.hpp"
+#include "publish.hpp"
+#include "batch.hpp"
+#include "threadpool.hpp"
+#include "partition.hpp"
+#include "diagnostics.hpp"
+#include "binary.hpp"
+#include "manifest.hpp"
+#include "fai.hpp"
+#include "grid.hpp"
 
 #include <unistd.h>
 #include <getopt.h>
@@ -12,6 +22,7 @@ using std::cout; using std::cerr; using std::endl;
 using std::ifstream; using std::ofstream;
 #include <vector>
 using std::vector;
+#include <sstream>
 #include <string>
 using std::string; using std::to_string; 
 #include <random>
@@ -19,50 +30,314 @@ using std::mt19937_64;
 
 string usage =
 "USAGE:\n"
-"  seres-resample [OPTIONS] <input alignment>\n\n"
+"  seres-resample [OPTIONS] <input alignment>...\n\n"
 "Options:\n"
 "  -h, --help               Print out this message. \n"
 "  -b, --bias <bias>        The probability of the resampler reversing direction\n"
 "                           at each site. Must be in (0..1]. Default is 0.01 \n"
 "  -l, --length <length>    The length of each resampled replicate. Default is\n"
-"                           the length of the input alignment.\n"
+"                           the length of the input alignment, or the total\n"
+"                           width of the partitions if -p is used.\n"
+"                           Either of -b and -l may be a comma separated list,\n"
+"                           e.g. -b 0.01,0.001 -l 1000,5000. Then every\n"
+"                           combination is resampled from the one input, each\n"
+"                           in a subdirectory named like b0.01-l1000 holding\n"
+"                           the files a run with just those values would.\n"
 "  -n, --number <num>       How many resampled replicates to produce.\n"
 "                           Default is 1.\n"
+"  -r, --range <start:end>  Only produce replicates start through end, numbered\n"
+"                           as in a full run. Every replicate is drawn from its\n"
+"                           own rng derived from the seed and its number, so\n"
+"                           ranges run on different machines with the same\n"
+"                           --seed give exactly the files of one large run.\n"
+"                           Requires --seed, can't be used with --number.\n"
 "  -d, --dir <output dir>   The directory the output replicates should be put in\n"
 "                           Defaults to the current working directory.\n"
 "  -s, --seed <rng-seed>    The seed for the PRNG (mt19937_64). \n"
 "                           Defaults to time in miliseconds since epoch.\n"
+"  -m, --shm <name>         Publish the input and the walks to the POSIX shared\n"
+"                           memory object <name> instead of writing files. See\n"
+"                           src/shm.hpp for the layout and a reader.\n"
+"  -M, --shm-replicates     With --shm, also publish the resampled replicates.\n"
+"  -p, --partitions <file>  Walk each range of columns listed in the file\n"
+"                           separately, one START:END range per line (0 based,\n"
+"                           end exclusive). Replicates are split between the\n"
+"                           partitions in proportion to their widths.\n"
+"  -R, --region <start:end> Only load columns start through end of the input,\n"
+"                           0 based and end exclusive. The walks then number\n"
+"                           the region's columns from 0.\n"
+"  -t, --taxa <list>        Only load these taxa, in this order. Either a comma\n"
+"                           separated list of names, or @file with one name per\n"
+"                           line.\n"
+"                           With --region or --taxa, a FASTA input is read\n"
+"                           through an index in <input>.sfai, which is built the\n"
+"                           first time, so only the selected data is read.\n"
+"  -f, --manifest <file>    Read input alignments from a file, one path per line.\n"
+"  -j, --threads <num>      Threads used when resampling several alignments,\n"
+"                           drawing the walks of several partitions or\n"
+"                           writing replicates of 64MiB or more.\n"
+"                           Defaults to the number of cores.\n"
+"  -F, --format <format>    Format of the replicates, either fasta or binary\n"
+"                           (see src/binary.hpp). Default is fasta.\n"
+"  -D, --diagnostics        Don't write any replicates. Draw the walks and print\n"
+"                           how evenly they cover the input's columns, how\n"
+"                           coverage changes near the edges, and how long the\n"
+"                           walks run before turning around.\n"
+"  -i, --incremental        Keep the replicates an earlier run left in the output\n"
+"                           directory, and only produce the ones which are\n"
+"                           missing or damaged. Existing replicates are checked\n"
+"                           against the sizes and modification times in its\n"
+"                           seres.manifest, and its seed is reused unless\n"
+"                           --seed is given.\n"
+"  -V, --verify             With --incremental, read every existing replicate\n"
+"                           and check it against its checksum instead of its\n"
+"                           modification time, e.g. after copying the files.\n"
+"  -v, --verbose            Print how busy each stage of the resampler was to\n"
+"                           stderr once all replicates are written, and how\n"
+"                           many of the input's rows were identical. Those are\n"
+"                           only resampled once.\n"
 "ARGS:\n"
-"  <input alignment>        A FASTA formatted multiple sequence alignment file.\n"
+"  <input alignment>        A FASTA formatted or binary (.sba) multiple sequence\n"
+"                           alignment file.\n"
+"                           If more than one is given (or --manifest is used),\n"
+"                           each one's replicates go in a subdirectory named\n"
+"                           after the file, and -l defaults to each input's\n"
+"                           own length.\n"
 ;
 
 //A function which is called by main, performs all the actual resampling after
-//the input is parsed and validated.
-void SERESResample(size_t number, size_t length, double bias, mt19937_64& rng,
-                   const CharMatrix& input_sequence, const vector<string>& taxa){
+//the input is parsed and validated. Generating walks, resampling and writing
+//overlap with each other, see pipeline.hpp. Every run records its replicates
+//in a manifest, so that an incremental run can reuse them, see manifest.hpp.
+void SERESResample(size_t first, size_t number, size_t length, double bias,
+                   size_t seed, bool seed_given, const CharMatrix& input_sequence,
+                   const vector<string>& taxa, const vector<Partition>& partitions,
+                   size_t threads, AlignmentFormat format, bool incremental,
+                   bool verify, bool verbose){
 
-    //We do number individual resampling runs starting from 1
-    for(size_t trial_num=1; trial_num<=number; trial_num++){
+    PipelineConfig config;
+    config.seed = seed;
+    config.first = first;
+    config.number = number;
+    config.length = length;
+    config.bias = bias;
+    config.partitions = partitions;
+    config.threads = threads;
+    config.format = format;
+    config.manifest = MANIFEST_FILE;
 
-        //Generate a new random walk using our parameters
-        RandomWalk walk = 
-            GenerateRandomWalk(input_sequence.length(), length, bias, rng);
+    //Work out which replicates an earlier run already produced. A run without
+    //--incremental writes its whole range again, but whatever the manifest
+    //lists outside that range is kept as long as it was made the same way.
+    RunManifest manifest;
+    try{
+        RunManifest previous;
+        bool found = false;
+        try{
+            found = ReadRunManifest(MANIFEST_FILE, previous);
+        }
+        catch (std::runtime_error& e){
+            //A damaged manifest is just replaced, unless it was to be reused
+            if(incremental){
+                throw;
+            }
+        }
+        if(found && incremental && !seed_given &&
+           previous.parameters.count("seed") != 0){
+            config.seed = std::stoull(previous.parameters["seed"]);
+        }
+        manifest.parameters = ManifestParameters(config, input_sequence, taxa);
+        string different;
+        for(const auto& parameter : manifest.parameters){
+            if(previous.parameters[parameter.first] != parameter.second){
+                different = parameter.first;
+                break;
+            }
+        }
+        if(found && incremental && !different.empty()){
+            cerr << "Error! The replicates in this directory were made"
+                    " with a different " << different << " (\""
+                 << previous.parameters[different] << "\" rather than \""
+                 << manifest.parameters[different] << "\")." << endl;
+            cerr << "Run without --incremental to replace them." << endl;
+            exit(1);
+        }
+        if(found && different.empty()){
+            manifest.replicates = previous.replicates;
+            if(incremental){
+                config.skip = VerifyReplicates(previous, "", format,
+                                               config.first, config.number,
+                                               threads, verify);
+            }
+            auto begin = manifest.replicates.lower_bound(config.first);
+            auto end = manifest.replicates.lower_bound(config.first + config.number);
+            manifest.replicates.erase(begin, end);
+            for(size_t replicate : config.skip){
+                manifest.replicates[replicate] = previous.replicates[replicate];
+            }
+        }
+        WriteRunManifest(MANIFEST_FILE, manifest);
+    }
+    catch (std::exception& e){
+        cerr << "Error! " << e.what() << endl;
+        exit(1);
+    }
+    if(verbose && incremental){
+        cerr << config.skip.size() << " of " << config.number
+             << " replicates already exist, producing the other "
+             << config.number - config.skip.size() << "." << endl;
+    }
 
-        //Resample using our new random walk
-        CharMatrix replicate_matrix = Resample(input_sequence, walk); 
+    PipelineStats stats;
+    try{
+        stats = RunResamplePipeline(config, input_sequence, taxa);
+    }
+    catch (std::runtime_error& e){
+        cerr << "Error! " << e.what() << endl;
+        exit(1);
+    }
 
-        //Open the output files
-        string walk_file_string = "replicate-" + to_string(trial_num) + ".walk";
-        string rep_file_string  = "replicate-" + to_string(trial_num) + ".fasta";
-        ofstream walk_file(walk_file_string);
-        ofstream rep_file(rep_file_string);
+    if(verbose){
+        cerr << stats;
+    }
+}
 
-        //Write the replicate alignment
-        WriteFASTA(rep_file, replicate_matrix, taxa);
+//Alternative to SERESResample which publishes everything to shared memory for
+//other processes on the node rather than writing replicate files. The walks
+//match a normal run with the same seed and range.
+void SERESPublish(size_t first, size_t number, size_t length, double bias,
+                  size_t seed, const CharMatrix& input_sequence,
+                  const vector<string>& taxa, const vector<Partition>& partitions,
+                  const string& name, bool materialize){
 
-        //Write the walk
-        walk_file << walk << endl;
+    vector<size_t> partition_lengths;
+    if(!partitions.empty()){
+        partition_lengths = PartitionLengths(partitions, length);
     }
+
+    vector<RandomWalk> walks;
+    walks.reserve(number);
+    for(size_t trial_num=first; trial_num<first+number; trial_num++){
+        mt19937_64 rng = ReplicateRNG(seed, trial_num);
+        if(partitions.empty()){
+            walks.push_back(
+                GenerateRandomWalk(input_sequence.length(), length, bias, rng));
+        }
+        else{
+            walks.push_back(GeneratePartitionedWalk(partitions, 
+                partition_lengths, bias, rng));
+        }
+    }
+
+    try{
+        PublishReplicates(name, input_sequence, taxa, walks, first, materialize);
+    }
+    catch (std::runtime_error& e){
+        cerr << "Error! " << e.what() << endl;
+        exit(1);
+    }
+}
+
+//Diagnostics mode, only the walks are drawn and their coverage of the input is
+//summarized on stdout. Nothing is resampled or written.
+void SERESDiagnostics(size_t first, size_t number, size_t length, double bias,
+                      size_t seed, size_t input_length, const vector<Partition>& partitions,
+                      size_t threads){
+
+    CoverageConfig config;
+    config.seed = seed;
+    config.first = first;
+    config.number = number;
+    config.length = length;
+    config.bias = bias;
+    config.threads = threads;
+    config.partitions = partitions;
+
+    cout << ComputeCoverage(config, input_length);
+}
+
+//Grid mode, resamples the input at every combination of the biases and
+//lengths on a pool of threads. Each one's replicates go in a subdirectory, see
+//grid.hpp.
+void SERESGrid(size_t first, size_t number, const vector<double>& biases,
+               const vector<size_t>& lengths, size_t seed,
+               const CharMatrix& input_sequence, const vector<string>& taxa,
+               const vector<Partition>& partitions, size_t threads,
+               AlignmentFormat format, bool verbose){
+
+    GridConfig config;
+    config.seed = seed;
+    config.first = first;
+    config.number = number;
+    config.biases = biases;
+    config.lengths = lengths;
+    config.partitions = partitions;
+    config.threads = threads;
+    config.format = format;
+
+    size_t failures;
+    GridStats stats;
+    try{
+        stats = RunGrid(config, input_sequence, taxa, cerr, failures);
+    }
+    catch (std::runtime_error& e){
+        cerr << "Error! " << e.what() << endl;
+        exit(1);
+    }
+
+    if(verbose){
+        cerr << stats;
+    }
+    if(failures != 0){
+        cerr << failures << " of " << stats.points
+             << " grid points could not be written." << endl;
+        exit(1);
+    }
+}
+
+//Batch mode, resamples every input alignment on a pool of threads. Each one's
+//replicates are put in a subdirectory, see batch.hpp.
+void SERESBatch(const vector<string>& inputs, size_t first, size_t number,
+                bool fixed_length,
+                size_t length, double bias, size_t threads, size_t seed,
+                AlignmentFormat format){
+
+    BatchConfig config;
+    config.first = first;
+    config.number = number;
+    config.fixed_length = fixed_length;
+    config.length = length;
+    config.bias = bias;
+    config.threads = threads;
+    config.format = format;
+
+    size_t failures;
+    try{
+        failures = RunBatch(inputs, config, seed, cerr);
+    }
+    catch (std::runtime_error& e){
+        cerr << "Error! " << e.what() << endl;
+        exit(1);
+    }
+
+    if(failures != 0){
+        cerr << failures << " of " << inputs.size() 
+             << " input alignments could not be resampled." << endl;
+        exit(1);
+    }
+}
+
+//Split a comma separated list, skipping empty items
+vector<string> SplitList(const string& list){
+    vector<string> items;
+    std::istringstream stream(list);
+    string item;
+    while(getline(stream, item, ',')){
+        if(!item.empty()){
+            items.push_back(item);
+        }
+    }
+    return items;
 }
 
 //Main function, primarily parses args
@@ -72,14 +347,27 @@ int main(int argc, char* argv[]){
     char c;
     extern char* optarg;
     extern int optind;
-    const char* const shortopts = "hb:l:n:d:s:";
+    const char* const shortopts = "hb:l:n:r:d:s:m:Mp:R:t:f:j:F:DiVv";
     const option longopts[] = {
         {"help", no_argument, nullptr, 'h'},
         {"bias", required_argument, nullptr, 'b'},
         {"length", required_argument, nullptr, 'l'},
         {"number", required_argument, nullptr, 'n'},
+        {"range", required_argument, nullptr, 'r'},
         {"dir", required_argument, nullptr, 'd'},
         {"seed", required_argument, nullptr, 's'},
+        {"shm", required_argument, nullptr, 'm'},
+        {"shm-replicates", no_argument, nullptr, 'M'},
+        {"partitions", required_argument, nullptr, 'p'},
+        {"region", required_argument, nullptr, 'R'},
+        {"taxa", required_argument, nullptr, 't'},
+        {"manifest", required_argument, nullptr, 'f'},
+        {"threads", required_argument, nullptr, 'j'},
+        {"format", required_argument, nullptr, 'F'},
+        {"diagnostics", no_argument, nullptr, 'D'},
+        {"incremental", no_argument, nullptr, 'i'},
+        {"verify", no_argument, nullptr, 'V'},
+        {"verbose", no_argument, nullptr, 'v'},
         {nullptr, 0, nullptr, 0}
     };
 
@@ -91,10 +379,31 @@ int main(int argc, char* argv[]){
     string larg;
     bool nflag = false;
     string narg;
+    bool rflag = false;
+    string rarg;
     bool dflag = false;
     string darg;
     bool sflag = false;
     string sarg;
+    bool mflag = false;
+    string marg;
+    bool Mflag = false;
+    bool pflag = false;
+    string parg;
+    bool Rflag = false;
+    string Rarg;
+    bool tflag = false;
+    string targ;
+    bool fflag = false;
+    string farg;
+    bool jflag = false;
+    string jarg;
+    bool Fflag = false;
+    string Farg;
+    bool Dflag = false;
+    bool iflag = false;
+    bool Vflag = false;
+    bool vflag = false;
 
     //Run getopt long to parse and grab these
     while((c = getopt_long(argc, argv, shortopts, longopts, nullptr)) != -1){
@@ -111,6 +420,10 @@ int main(int argc, char* argv[]){
                 nflag = true;
                 narg.assign(optarg);
                 break;
+            case 'r':
+                rflag = true;
+                rarg.assign(optarg);
+                break;
             case 'd':
                 dflag = true;
                 darg.assign(optarg);
@@ -119,6 +432,49 @@ int main(int argc, char* argv[]){
                 sflag = true;
                 sarg.assign(optarg);
                 break;
+            case 'm':
+                mflag = true;
+                marg.assign(optarg);
+                break;
+            case 'M':
+                Mflag = true;
+                break;
+            case 'p':
+                pflag = true;
+                parg.assign(optarg);
+                break;
+            case 'R':
+                Rflag = true;
+                Rarg.assign(optarg);
+                break;
+            case 't':
+                tflag = true;
+                targ.assign(optarg);
+                break;
+            case 'f':
+                fflag = true;
+                farg.assign(optarg);
+                break;
+            case 'j':
+                jflag = true;
+                jarg.assign(optarg);
+                break;
+            case 'F':
+                Fflag = true;
+                Farg.assign(optarg);
+                break;
+            case 'D':
+                Dflag = true;
+                break;
+            case 'i':
+                iflag = true;
+                break;
+            case 'V':
+                Vflag = true;
+                break;
+            case 'v':
+                vflag = true;
+                break;
             case 'h':
                 cerr << usage << endl;
                 exit(0);
@@ -130,46 +486,164 @@ int main(int argc, char* argv[]){
         }
     }
 
-    //Calculate the number of positional args, if there are more or less than 1,
-    //then we can't continue.
-    int num_positional_args = argc - optind;
-    if(num_positional_args != 1){
-        cerr << "Error! Exactly one positional arg must be supplied but " 
-             << num_positional_args << " were found." << endl << endl;
+    //Gather the input alignments, from the positional args and the manifest
+    vector<string> inputs(argv + optind, argv + argc);
+    if(fflag){
+        ifstream manifest_file(farg);
+        if(!manifest_file.is_open()){
+            cerr << "Error! The manifest file \"" << farg 
+                 << "\" could not be opened." << endl << endl;
+            cerr << usage << endl;
+            exit(1);
+        }
+        vector<string> listed = ReadManifest(manifest_file);
+        inputs.insert(inputs.end(), listed.begin(), listed.end());
+    }
+    if(inputs.empty()){
+        cerr << "Error! At least one input alignment must be supplied." 
+             << endl << endl;
         cerr << usage << endl;
         exit(1);
     }
 
-    //Next, we should open the input file the user provided, if we can't then
-    //warn the user and exit.
-    ifstream input_alignment_file(argv[optind]);
-    if(!input_alignment_file.is_open()){
-        cerr << "Error! The input alignment file \"" << argv[optind]
-             << "\" could not be opened." << endl;
-        cerr << "Check that it exists and you have permission to open it." << endl;
-        cerr << endl;
+    //More than one input means batch mode, where every input is read later on
+    //by the thread that resamples it.
+    bool batch = fflag || inputs.size() > 1;
+    if(batch && (mflag || pflag || Dflag || iflag || Rflag || tflag)){
+        cerr << "Error! --shm, --partitions, --diagnostics, --incremental, --region"
+                " and --taxa can only be used with a single input alignment."
+             << endl << endl;
         cerr << usage << endl;
         exit(1);
     }
 
-    //Nice, now we need to parse the input alignment file into a char matrix and
-    //a vector of taxa.
+    //Work out which part of the input to load, if not all of it
+    AlignmentSubset subset;
+    if(Rflag){
+        size_t colon = Rarg.find(':');
+        try{
+            if(colon == string::npos){
+                throw std::invalid_argument(Rarg);
+            }
+            subset.start = stoul(Rarg.substr(0, colon));
+            subset.end = stoul(Rarg.substr(colon + 1));
+        }
+        catch (std::logic_error& e){
+            cerr << "Error! The region arg \"" << Rarg << "\"," << endl;
+            cerr << "must be of the form START:END, with both non-negative integers.";
+            cerr << endl << endl;
+            cerr << usage << endl;
+            exit(1);
+        }
+        if(subset.end <= subset.start){
+            cerr << "Error! The region must have START < END." << endl << endl;
+            cerr << usage << endl;
+            exit(1);
+        }
+    }
+    if(tflag){
+        string name;
+        if(targ.size() > 0 && targ[0] == '@'){
+            ifstream taxa_file(targ.substr(1));
+            if(!taxa_file.is_open()){
+                cerr << "Error! The taxa file \"" << targ.substr(1)
+                     << "\" could not be opened." << endl << endl;
+                cerr << usage << endl;
+                exit(1);
+            }
+            while(getline(taxa_file, name)){
+                if(!name.empty()){
+                    subset.taxa.push_back(name);
+                }
+            }
+        }
+        else{
+            subset.taxa = SplitList(targ);
+        }
+        if(subset.taxa.empty()){
+            cerr << "Error! --taxa must name at least one taxon." << endl << endl;
+            cerr << usage << endl;
+            exit(1);
+        }
+    }
+
+    //Otherwise, we should open the input file the user provided, if we can't
+    //then warn the user and exit.
     CharMatrix input_sequences;
     vector<string> input_taxa;
-    try{
-        ReadFASTA(input_alignment_file, input_sequences, input_taxa);
+    if(!batch){
+        ifstream input_alignment_file(inputs[0]);
+        if(!input_alignment_file.is_open()){
+            cerr << "Error! The input alignment file \"" << inputs[0]
+                 << "\" could not be opened." << endl;
+            cerr << "Check that it exists and you have permission to open it." << endl;
+            cerr << endl;
+            cerr << usage << endl;
+            exit(1);
+        }
+        input_alignment_file.close();
+
+        //Nice, now we need to parse the input alignment file into a char matrix
+        //and a vector of taxa. Binary alignments are mapped rather than parsed,
+        //and only the selected part of either is loaded if there is one.
+        if(Rflag || tflag){
+            try{
+                ReadAlignmentSubset(inputs[0], subset, input_sequences, input_taxa);
+            }
+            catch (std::runtime_error& e){
+                cerr << "Error! Could not load the selected part of \""
+                     << inputs[0] << "\": " << e.what() << endl << endl;
+                cerr << usage << endl;
+                exit(1);
+            }
+        }
+        else{
+            try{
+                ReadAlignmentFile(inputs[0], input_sequences, input_taxa);
+            }
+            catch (std::runtime_error e){
+                cerr << "The provided alignment file \"" << inputs[0] << "\""
+                        " is not an alignment." << endl;
+                cerr << "Check that all the sequences it contains are the same length." 
+                     << endl << endl;
+                cerr << usage << endl;
+                exit(1);
+            }
+        }
     }
-    catch (std::runtime_error e){
-        cerr << "The provided fasta file \"" << argv[optind] << "\""
-                " is not an alignment." << endl;
-        cerr << "Check that all the sequences it contains are the same length." 
-             << endl << endl;
-        cerr << usage << endl;
-        exit(1);
+
+    //Read the partitions, these are checked against the input's length
+    vector<Partition> partitions;
+    if(pflag){
+        ifstream partition_file(parg);
+        if(!partition_file.is_open()){
+            cerr << "Error! The partition file \"" << parg 
+                 << "\" could not be opened." << endl << endl;
+            cerr << usage << endl;
+            exit(1);
+        }
+        try{
+            partitions = ReadPartitions(partition_file, input_sequences.length());
+        }
+        catch (std::runtime_error& e){
+            cerr << "Error! " << e.what() << endl << endl;
+            cerr << usage << endl;
+            exit(1);
+        }
     }
 
-    //Now lets deal with the directory argument, if the user set it.
+    //Now lets deal with the directory argument, if the user set it. In batch
+    //mode the inputs are read after this, so relative paths are made absolute
+    //before the working directory changes.
     if(dflag){
+        char* cwd = getcwd(nullptr, 0);
+        for(string& input : inputs){
+            if(cwd != nullptr && input.size() > 0 && input[0] != '/'){
+                input = string(cwd) + "/" + input;
+            }
+        }
+        free(cwd);
+
         int result = chdir(darg.c_str());
         if(result != 0){
             cerr << "Error! The directory \"" << darg << "\" could not be opened." 
@@ -181,41 +655,77 @@ int main(int argc, char* argv[]){
         }
     }
 
-    //Next, let's deal with the bias arg
-    double bias = 0.01;   //Default value
+    //Next, let's deal with the bias arg, which may list several biases
+    vector<double> biases = {0.01};   //Default value
     if(bflag){
-        try{
-            bias = stod(barg);
+        biases.clear();
+        for(const string& item : SplitList(barg)){
+            double bias;
+            try{
+                bias = stod(item);
+            }
+            catch (std::logic_error& e){
+                cerr << "Error! The provided bias arg \"" << item << "\"," << endl;
+                cerr << "could not be converted to a real number value." << endl;
+                cerr << endl;
+                cerr << usage << endl;
+                exit(1);
+            }
+
+            if(bias < 0 || bias >= 1){
+                cerr << "Error! The bias parameter must be in (0..1]." 
+                     << endl << endl;
+                cerr << usage << endl; 
+                exit(1);
+            }
+            biases.push_back(bias);
         }
-        catch (std::invalid_argument e){
-            cerr << "Error! The provided bias arg \"" << barg << "\"," << endl;
-            cerr << "could not be converted to a real number value." << endl;
-            cerr << endl;
+        if(biases.empty()){
+            cerr << "Error! --bias must give at least one bias." << endl << endl;
             cerr << usage << endl;
             exit(1);
         }
-
-        if(bias < 0 || bias >= 1){
-            cerr << "Error! The bias parameter must be in (0..1]." 
-                 << endl << endl;
-            cerr << usage << endl; 
-            exit(1);
-        }
     }
+    double bias = biases[0];
 
     //Deal with the length parameter TODO more extensive testing
     size_t length = input_sequences.length();   //Default value
+    if(!partitions.empty()){
+        length = 0;
+        for(const Partition& partition : partitions){
+            length += partition.width();
+        }
+    }
+    vector<size_t> lengths = {length};
     if(lflag){
-        try{
-            length = stoul(larg); 
+        lengths.clear();
+        for(const string& item : SplitList(larg)){
+            try{
+                lengths.push_back(stoul(item));
+            }
+            catch (std::logic_error& e){
+                cerr << "Error! The length arg \"" << item << "\", "  << endl;
+                cerr << "could not be converted to an non-negative integer value.";
+                cerr << endl << endl;
+                cerr << usage << endl;
+                exit(1);
+            }
         }
-        catch (std::invalid_argument e){
-            cerr << "Error! The length arg \"" << larg << "\", "  << endl;
-            cerr << "could not be converted to an non-negative integer value.";
-            cerr << endl << endl;
+        if(lengths.empty()){
+            cerr << "Error! --length must give at least one length." << endl << endl;
             cerr << usage << endl;
             exit(1);
         }
+        length = lengths[0];
+    }
+
+    //Several biases or lengths mean grid mode
+    bool grid = biases.size() > 1 || lengths.size() > 1;
+    if(grid && (batch || mflag || Dflag || iflag)){
+        cerr << "Error! Lists of biases or lengths can't be used with several"
+                " inputs, --shm, --diagnostics or --incremental." << endl << endl;
+        cerr << usage << endl;
+        exit(1);
     }
 
     //deal witht the number of replicates
@@ -233,10 +743,79 @@ int main(int argc, char* argv[]){
         }
     }
 
+    //Or the range of replicates, which replaces the number
+    size_t first = 1;   //Default value
+    if(rflag){
+        if(nflag){
+            cerr << "Error! --range and --number are mutually exclusive." 
+                 << endl << endl;
+            cerr << usage << endl;
+            exit(1);
+        }
+        if(!sflag){
+            cerr << "Error! --range needs a --seed, or the ranges wouldn't come"
+                    " from the same run." << endl << endl;
+            cerr << usage << endl;
+            exit(1);
+        }
+
+        size_t colon = rarg.find(':');
+        size_t last = 0;
+        try{
+            if(colon == string::npos){
+                throw std::invalid_argument(rarg);
+            }
+            first = stoul(rarg.substr(0, colon));
+            last = stoul(rarg.substr(colon + 1));
+        }
+        catch (std::logic_error& e){
+            cerr << "Error! The range arg \"" << rarg << "\"," << endl;
+            cerr << "must be of the form START:END, with both non-negative integers.";
+            cerr << endl << endl;
+            cerr << usage << endl;
+            exit(1);
+        }
+        if(first == 0 || last < first){
+            cerr << "Error! The range must have 1 <= START <= END, replicates"
+                    " are numbered from 1." << endl << endl;
+            cerr << usage << endl;
+            exit(1);
+        }
+        number = last - first + 1;
+    }
+
+    //Deal with the output format
+    AlignmentFormat format = AlignmentFormat::FASTA;    //Default value
+    if(Fflag){
+        if(Farg == "binary"){
+            format = AlignmentFormat::Binary;
+        }
+        else if(Farg != "fasta"){
+            cerr << "Error! The format arg \"" << Farg << "\" must be either"
+                    " fasta or binary." << endl << endl;
+            cerr << usage << endl;
+            exit(1);
+        }
+    }
+
+    //Deal with the number of threads
+    size_t threads = ThreadPool::default_threads();    //Default value
+    if(jflag){
+        try{
+            threads = stoul(jarg); 
+        }
+        catch (std::logic_error& e){
+            cerr << "Error! The threads arg \"" << jarg << "\", "  << endl;
+            cerr << "could not be converted to an non-negative integer value.";
+            cerr << endl << endl;
+            cerr << usage << endl;
+            exit(1);
+        }
+    }
+
     //Finally, we need to deal with seeding the RNG
-    mt19937_64 rng;
+    size_t seed;
     if(sflag){
-        size_t seed;
         try{
             seed = stoul(sarg); 
         }
@@ -247,17 +826,60 @@ int main(int argc, char* argv[]){
             cerr << usage << endl;
             exit(1);
         }
-        rng.seed(seed);
     }
     else{
         struct timeval tp;
         gettimeofday(&tp, NULL);
         long int ms = tp.tv_sec * 1000 + tp.tv_usec / 1000; 
-        rng.seed(ms);
+        seed = ms;
     }
 
     //The last step, farm off the resampling work to another function.
-    SERESResample(number, length, bias, rng, input_sequences, input_taxa);
+    if(Dflag && mflag){
+        cerr << "Error! --diagnostics and --shm are mutually exclusive." 
+             << endl << endl;
+        cerr << usage << endl;
+        exit(1);
+    }
+    if(iflag && (Dflag || mflag)){
+        cerr << "Error! --incremental only applies when replicate files are"
+                " written, not with --diagnostics or --shm." << endl << endl;
+        cerr << usage << endl;
+        exit(1);
+    }
+    if(Vflag && !iflag){
+        cerr << "Error! --verify only makes sense along with --incremental."
+             << endl << endl;
+        cerr << usage << endl;
+        exit(1);
+    }
+    if(Mflag && !mflag){
+        cerr << "Error! --shm-replicates only makes sense along with --shm." 
+             << endl << endl;
+        cerr << usage << endl;
+        exit(1);
+    }
+    if(Dflag){
+        SERESDiagnostics(first, number, length, bias, seed,
+                         input_sequences.length(), partitions, threads);
+    }
+    else if(grid){
+        SERESGrid(first, number, biases, lengths, seed, input_sequences,
+                  input_taxa, partitions, threads, format, vflag);
+    }
+    else if(batch){
+        SERESBatch(inputs, first, number, lflag, length, bias, threads, seed,
+                   format);
+    }
+    else if(mflag){
+        SERESPublish(first, number, length, bias, seed, input_sequences,
+                     input_taxa, partitions, marg, Mflag);
+    }
+    else{
+        SERESResample(first, number, length, bias, seed, sflag, input_sequences,
+                      input_taxa, partitions, threads, format, iflag, Vflag,
+                      vflag);
+    }
 
     return 0;
 }
@@ -0,0 +1,412 @@
+#include "sequence.hpp"
+#include "pipeline.hpp"
+#include "runner.hpp"
+#include "threadpool.hpp"
+#include "partition.hpp"
+#include "binary.hpp"
+
+#include <getopt.h>
+#include <sys/time.h>
+#include <sys/stat.h>
+
+#include <cstring>
+#include <iostream>
+using std::cerr; using std::endl;
+#include <fstream>
+using std::ifstream;
+#include <vector>
+using std::vector;
+#include <string>
+using std::string;
+#include <stdexcept>
+
+string usage =
+"USAGE:\n"
+"  seres-run [OPTIONS] <input alignment> -- <command> [<arg>...]\n\n"
+"Draws replicates of the input and runs the command once for each one, with\n"
+"the replicate streamed to the command's stdin rather than written to disk.\n"
+"At most --jobs commands run at once and a replicate is only drawn when a job\n"
+"is free to run it. Each command's stdout is kept in replicate-N.out next to\n"
+"replicate-N.walk, so its results can be translated with seres-translate, and\n"
+"the command can find N in $SERES_REPLICATE. For example:\n\n"
+"  seres-run -s 42 -n 1000 -j 16 -d runs alignment.fasta -- infer --stdin\n\n"
+"Replicates are identical to the ones seres-resample writes with the same\n"
+"seed and options. Exits with 1 if any command failed, see --verbose.\n\n"
+"Options:\n"
+"  -h, --help               Print out this message.\n"
+"  -b, --bias <bias>        The probability of the resampler reversing direction\n"
+"                           at each site. Must be in (0..1]. Default is 0.01\n"
+"  -l, --length <length>    The length of each resampled replicate. Default is\n"
+"                           the length of the input alignment, or the total\n"
+"                           width of the partitions if -p is used.\n"
+"  -n, --number <num>       How many replicates to run the command on.\n"
+"                           Default is 1.\n"
+"  -r, --range <start:end>  Only run replicates start through end, as for\n"
+"                           seres-resample. Requires --seed.\n"
+"  -d, --dir <output dir>   Where the .out and .walk files go. Defaults to the\n"
+"                           current working directory. Commands still run in\n"
+"                           the current working directory.\n"
+"  -s, --seed <rng-seed>    The seed for the PRNG (mt19937_64).\n"
+"                           Defaults to time in miliseconds since epoch.\n"
+"  -p, --partitions <file>  Walk each range of columns listed in the file\n"
+"                           separately, as for seres-resample.\n"
+"  -j, --jobs <num>         How many commands run at once.\n"
+"                           Defaults to the number of cores.\n"
+"  -F, --format <format>    Format the replicates are streamed in, either fasta\n"
+"                           or binary (see src/binary.hpp). Default is fasta.\n"
+"  -v, --verbose            Print which replicates failed and how the time was\n"
+"                           split between resampling and the commands.\n"
+"ARGS:\n"
+"  <input alignment>        A FASTA formatted or binary (.sba) multiple sequence\n"
+"                           alignment file.\n"
+"  <command> [<arg>...]     The command to run, looked up on the PATH. It isn't\n"
+"                           run through a shell.\n"
+;
+
+int main(int argc, char* argv[]){
+
+    //Everything after -- is the command, which getopt shouldn't see
+    vector<string> command;
+    for(int i = 1; i < argc; i++){
+        if(std::strcmp(argv[i], "--") == 0){
+            command.assign(argv + i + 1, argv + argc);
+            argc = i;
+            break;
+        }
+    }
+
+    //Define the options for GNU getopt_long
+    char c;
+    extern char* optarg;
+    extern int optind;
+    const char* const shortopts = "hb:l:n:r:d:s:p:j:F:v";
+    const option longopts[] = {
+        {"help", no_argument, nullptr, 'h'},
+        {"bias", required_argument, nullptr, 'b'},
+        {"length", required_argument, nullptr, 'l'},
+        {"number", required_argument, nullptr, 'n'},
+        {"range", required_argument, nullptr, 'r'},
+        {"dir", required_argument, nullptr, 'd'},
+        {"seed", required_argument, nullptr, 's'},
+        {"partitions", required_argument, nullptr, 'p'},
+        {"jobs", required_argument, nullptr, 'j'},
+        {"format", required_argument, nullptr, 'F'},
+        {"verbose", no_argument, nullptr, 'v'},
+        {nullptr, 0, nullptr, 0}
+    };
+
+    //These flags will get set to true and the args will get set when they are
+    //supplied on the CLI.
+    bool bflag = false;
+    string barg;
+    bool lflag = false;
+    string larg;
+    bool nflag = false;
+    string narg;
+    bool rflag = false;
+    string rarg;
+    bool dflag = false;
+    string darg;
+    bool sflag = false;
+    string sarg;
+    bool pflag = false;
+    string parg;
+    bool jflag = false;
+    string jarg;
+    bool Fflag = false;
+    string Farg;
+    bool vflag = false;
+
+    //Run getopt long to parse and grab these
+    while((c = getopt_long(argc, argv, shortopts, longopts, nullptr)) != -1){
+        switch(c){
+            case 'b':
+                bflag = true;
+                barg.assign(optarg);
+                break;
+            case 'l':
+                lflag = true;
+                larg.assign(optarg);
+                break;
+            case 'n':
+                nflag = true;
+                narg.assign(optarg);
+                break;
+            case 'r':
+                rflag = true;
+                rarg.assign(optarg);
+                break;
+            case 'd':
+                dflag = true;
+                darg.assign(optarg);
+                break;
+            case 's':
+                sflag = true;
+                sarg.assign(optarg);
+                break;
+            case 'p':
+                pflag = true;
+                parg.assign(optarg);
+                break;
+            case 'j':
+                jflag = true;
+                jarg.assign(optarg);
+                break;
+            case 'F':
+                Fflag = true;
+                Farg.assign(optarg);
+                break;
+            case 'v':
+                vflag = true;
+                break;
+            case 'h':
+                cerr << usage << endl;
+                exit(0);
+                break;
+            case '?':
+                cerr << usage << endl;
+                exit(1);
+                break;
+        }
+    }
+
+    if(optind + 1 != argc){
+        cerr << "Error! Exactly one input alignment must be supplied."
+             << endl << endl;
+        cerr << usage << endl;
+        exit(1);
+    }
+    if(command.empty()){
+        cerr << "Error! A command must be given after --." << endl << endl;
+        cerr << usage << endl;
+        exit(1);
+    }
+
+    //Read the input, binary alignments are mapped rather than parsed
+    string input_path = argv[optind];
+    CharMatrix input_sequences;
+    vector<string> input_taxa;
+    try{
+        ReadAlignmentFile(input_path, input_sequences, input_taxa);
+    }
+    catch (std::runtime_error& e){
+        cerr << "Error! The input alignment \"" << input_path << "\" could not"
+                " be read: " << e.what() << endl << endl;
+        cerr << usage << endl;
+        exit(1);
+    }
+
+    //Read the partitions, these are checked against the input's length
+    vector<Partition> partitions;
+    if(pflag){
+        ifstream partition_file(parg);
+        if(!partition_file.is_open()){
+            cerr << "Error! The partition file \"" << parg
+                 << "\" could not be opened." << endl << endl;
+            cerr << usage << endl;
+            exit(1);
+        }
+        try{
+            partitions = ReadPartitions(partition_file, input_sequences.length());
+        }
+        catch (std::runtime_error& e){
+            cerr << "Error! " << e.what() << endl << endl;
+            cerr << usage << endl;
+            exit(1);
+        }
+    }
+
+    //The output directory has to exist already
+    if(dflag){
+        struct stat info;
+        if(stat(darg.c_str(), &info) != 0 || !S_ISDIR(info.st_mode)){
+            cerr << "Error! The directory \"" << darg << "\" could not be opened."
+                 << endl << endl;
+            cerr << usage << endl;
+            exit(1);
+        }
+    }
+
+    //Next, let's deal with the bias arg
+    double bias = 0.01;   //Default value
+    if(bflag){
+        try{
+            bias = stod(barg);
+        }
+        catch (std::invalid_argument& e){
+            cerr << "Error! The provided bias arg \"" << barg << "\"," << endl;
+            cerr << "could not be converted to a real number value." << endl;
+            cerr << endl;
+            cerr << usage << endl;
+            exit(1);
+        }
+
+        if(bias < 0 || bias >= 1){
+            cerr << "Error! The bias parameter must be in (0..1]."
+                 << endl << endl;
+            cerr << usage << endl;
+            exit(1);
+        }
+    }
+
+    //The length defaults as it does for seres-resample
+    size_t length = input_sequences.length();   //Default value
+    if(!partitions.empty()){
+        length = 0;
+        for(const Partition& partition : partitions){
+            length += partition.width();
+        }
+    }
+    if(lflag){
+        try{
+            length = stoul(larg);
+        }
+        catch (std::invalid_argument& e){
+            cerr << "Error! The length arg \"" << larg << "\", "  << endl;
+            cerr << "could not be converted to an non-negative integer value.";
+            cerr << endl << endl;
+            cerr << usage << endl;
+            exit(1);
+        }
+    }
+
+    //Deal with the number of replicates
+    size_t number = 1; //Default value
+    if(nflag){
+        try{
+            number = stoul(narg);
+        }
+        catch (std::invalid_argument& e){
+            cerr << "Error! The number arg \"" << narg << "\", "  << endl;
+            cerr << "could not be converted to an non-negative integer value.";
+            cerr << endl << endl;
+            cerr << usage << endl;
+            exit(1);
+        }
+    }
+
+    //Or the range of replicates, which replaces the number
+    size_t first = 1;   //Default value
+    if(rflag){
+        if(nflag){
+            cerr << "Error! --range and --number are mutually exclusive."
+                 << endl << endl;
+            cerr << usage << endl;
+            exit(1);
+        }
+        if(!sflag){
+            cerr << "Error! --range needs a --seed, or the ranges wouldn't come"
+                    " from the same run." << endl << endl;
+            cerr << usage << endl;
+            exit(1);
+        }
+
+        size_t colon = rarg.find(':');
+        size_t last = 0;
+        try{
+            if(colon == string::npos){
+                throw std::invalid_argument(rarg);
+            }
+            first = stoul(rarg.substr(0, colon));
+            last = stoul(rarg.substr(colon + 1));
+        }
+        catch (std::logic_error& e){
+            cerr << "Error! The range arg \"" << rarg << "\"," << endl;
+            cerr << "must be of the form START:END, with both non-negative integers.";
+            cerr << endl << endl;
+            cerr << usage << endl;
+            exit(1);
+        }
+        if(first == 0 || last < first){
+            cerr << "Error! The range must have 1 <= START <= END, replicates"
+                    " are numbered from 1." << endl << endl;
+            cerr << usage << endl;
+            exit(1);
+        }
+        number = last - first + 1;
+    }
+
+    //Deal with the format replicates are streamed in
+    AlignmentFormat format = AlignmentFormat::FASTA;    //Default value
+    if(Fflag){
+        if(Farg == "binary"){
+            format = AlignmentFormat::Binary;
+        }
+        else if(Farg != "fasta"){
+            cerr << "Error! The format arg \"" << Farg << "\" must be either"
+                    " fasta or binary." << endl << endl;
+            cerr << usage << endl;
+            exit(1);
+        }
+    }
+
+    //Deal with the number of jobs
+    size_t jobs = ThreadPool::default_threads();    //Default value
+    if(jflag){
+        try{
+            jobs = stoul(jarg);
+        }
+        catch (std::invalid_argument& e){
+            cerr << "Error! The jobs arg \"" << jarg << "\", "  << endl;
+            cerr << "could not be converted to an non-negative integer value.";
+            cerr << endl << endl;
+            cerr << usage << endl;
+            exit(1);
+        }
+    }
+
+    //Finally, we need to deal with seeding the RNG
+    size_t seed;
+    if(sflag){
+        try{
+            seed = stoul(sarg);
+        }
+        catch (std::invalid_argument& e){
+            cerr << "Error! The seed arg \"" << sarg << "\", "  << endl;
+            cerr << "could not be converted to an non-negative integer value.";
+            cerr << endl << endl;
+            cerr << usage << endl;
+            exit(1);
+        }
+    }
+    else{
+        struct timeval tp;
+        gettimeofday(&tp, NULL);
+        long int ms = tp.tv_sec * 1000 + tp.tv_usec / 1000;
+        seed = ms;
+    }
+
+    PipelineConfig config;
+    config.seed = seed;
+    config.first = first;
+    config.number = number;
+    config.length = length;
+    config.bias = bias;
+    config.partitions = partitions;
+    config.threads = jobs;
+    config.format = format;
+    config.directory = darg;
+
+    RunnerStats stats;
+    try{
+        stats = RunCommandOnReplicates(config, command, input_sequences,
+                                       input_taxa);
+    }
+    catch (std::runtime_error& e){
+        cerr << "Error! " << e.what() << endl;
+        exit(1);
+    }
+
+    if(vflag){
+        cerr << stats;
+        for(size_t replicate : stats.failed){
+            cerr << "replicate " << replicate << " failed" << endl;
+        }
+    }
+    if(!stats.failed.empty()){
+        cerr << "Error! The command failed on " << stats.failed.size() << " of "
+             << stats.replicates << " replicates." << endl;
+        exit(1);
+    }
+    return 0;
+}
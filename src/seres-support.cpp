@@ -0,0 +1,311 @@
+#include "walk.hpp"
+#include "translate.hpp"
+
+#include <getopt.h>
+
+#include <iostream>
+using std::cout; using std::cerr; using std::endl;
+#include <fstream>
+using std::ifstream;
+#include <sstream>
+using std::ostringstream;
+#include <string>
+using std::string; using std::getline; using std::to_string;
+#include <vector>
+using std::vector;
+#include <algorithm>
+using std::sort; using std::unique; using std::max;
+#include <thread>
+using std::thread;
+#include <atomic>
+using std::atomic;
+#include <mutex>
+using std::mutex; using std::lock_guard;
+#include <stdexcept>
+
+string usage =
+"USAGE:\n"
+"  seres-support [OPTIONS] (<walk file> <result file>)...\n\n"
+"FLAGS:\n"
+"  -h, --help              Display this message.\n"
+"  -p, --position          Results are positions. (default)\n"
+"  -b, --breakpoint        Results are breakpoints.\n\n"
+"OPTIONS:\n"
+"  -f, --file <file>       Read pairs of walk and result files from a file, one\n"
+"                          pair per line separated by whitespace.\n"
+"  -s, --sep <separator>   Separator for result locations, default is ','\n"
+"  -L, --length <length>   Length of the original alignment. Defaults to just\n"
+"                          past the largest site any walk visits.\n"
+"  -j, --threads <num>     Number of threads to use. Defaults to the number of\n"
+"                          cores.\n\n"
+"ARGS:\n"
+"  <walk file>             A walk file produced by seres-resample.\n"
+"  <result file>           Locations in the replicate made with that walk, in\n"
+"                          the format read by seres-translate.\n\n"
+"Every result is translated back to the original alignment and the number of\n"
+"replicates which support each original site is written to stdout, one line\n"
+"per site with the site, the count and the fraction of replicates.\n"
+;
+
+//One replicate's worth of input
+struct ReplicateResult{
+    string walk_path;
+    string result_path;
+};
+
+//Translate every location of one replicate into original sites, each site is
+//counted once per replicate no matter how often the walk visited it.
+vector<size_t> TranslateReplicate(const ReplicateResult& pair, char sep,
+                                  bool breakpoints, size_t& walk_extent){
+    RandomWalk walk = ReadWalkFile(pair.walk_path);
+
+    ifstream result_file(pair.result_path);
+    if(!result_file.is_open()){
+        throw std::runtime_error("could not open \"" + pair.result_path + "\"");
+    }
+    vector<size_t> locations = ReadLocations(result_file, sep);
+
+    //How far the original must extend, in case no length was given
+    walk_extent = 0;
+    for(const WalkSegment& ws : walk){
+        size_t last = ws.direction == Direction::Right ?
+            ws.original_pos + ws.length - 1 : ws.original_pos;
+        walk_extent = max(walk_extent, last + 1 + (breakpoints ? 1 : 0));
+    }
+
+    vector<size_t> sites;
+    sites.reserve(locations.size());
+    size_t limit = walk.length() + (breakpoints ? 1 : 0);
+    for(size_t location : locations){
+        if(location >= limit){
+            throw std::runtime_error("location " + to_string(location) +
+                                     " in \"" + pair.result_path +
+                                     "\" is past the end of the replicate");
+        }
+        if(breakpoints){
+            sites.push_back(walk.lookup_breakpoint(location));
+        }
+        else{
+            sites.push_back(walk.lookup_position(location));
+        }
+    }
+    sort(sites.begin(), sites.end());
+    sites.erase(unique(sites.begin(), sites.end()), sites.end());
+    return sites;
+}
+
+//Each thread takes the next replicate off a shared counter and adds it to its
+//own histogram, so threads never touch shared counts until the final merge.
+struct SupportWorker{
+    vector<size_t> histogram;
+    size_t extent = 0;
+};
+
+void SupportThread(const vector<ReplicateResult>& pairs, atomic<size_t>& next,
+                   char sep, bool breakpoints, SupportWorker& worker,
+                   mutex& error_mutex, size_t& failures){
+    size_t index;
+    while((index = next++) < pairs.size()){
+        try{
+            size_t walk_extent;
+            vector<size_t> sites =
+                TranslateReplicate(pairs[index], sep, breakpoints, walk_extent);
+            worker.extent = max(worker.extent, walk_extent);
+            if(!sites.empty() && sites.back() >= worker.histogram.size()){
+                worker.histogram.resize(sites.back() + 1, 0);
+            }
+            for(size_t site : sites){
+                worker.histogram[site]++;
+            }
+        }
+        catch(std::exception& e){
+            lock_guard<mutex> lock(error_mutex);
+            cerr << "Error! Replicate " << index + 1 << ": " << e.what() << endl;
+            failures++;
+        }
+    }
+}
+
+int main(int argc, char* argv[]){
+
+    //Define the options for GNU getopt_long
+    char c;
+    extern char* optarg;
+    extern int optind;
+    const char* const shortopts = "hpbf:s:L:j:";
+    const option longopts[] = {
+        {"help", no_argument, nullptr, 'h'},
+        {"position", no_argument, nullptr, 'p'},
+        {"breakpoint", no_argument, nullptr, 'b'},
+        {"file", required_argument, nullptr, 'f'},
+        {"sep", required_argument, nullptr, 's'},
+        {"length", required_argument, nullptr, 'L'},
+        {"threads", required_argument, nullptr, 'j'},
+        {nullptr, 0, nullptr, 0}
+    };
+
+    //Flags
+    bool pflag = false;
+    bool bflag = false;
+
+    //Options
+    bool fflag = false;
+    string farg;
+    bool sflag = false;
+    string sarg;
+    bool Lflag = false;
+    string Larg;
+    bool jflag = false;
+    string jarg;
+
+    //Run getopt long to parse and grab these
+    while((c = getopt_long(argc, argv, shortopts, longopts, nullptr)) != -1){
+        switch(c){
+            case 'p':
+                pflag = true;
+                break;
+            case 'b':
+                bflag = true;
+                break;
+            case 'f':
+                fflag = true;
+                farg.assign(optarg);
+                break;
+            case 's':
+                sflag = true;
+                sarg.assign(optarg);
+                break;
+            case 'L':
+                Lflag = true;
+                Larg.assign(optarg);
+                break;
+            case 'j':
+                jflag = true;
+                jarg.assign(optarg);
+                break;
+            case 'h':
+                cerr << usage << endl;
+                exit(0);
+                break;
+            case '?':
+                cerr << usage << endl;
+                exit(1);
+                break;
+        }
+    }
+
+    //Make sure the b and p flag are set appropriatly
+    if(bflag && pflag){
+        cerr << "Error, the -b and -p flags are mutually exclusive." << endl;
+        cerr << endl << usage << endl;
+        exit(1);
+    }
+
+    //Gather the pairs of walk and result files
+    int num_positional_args = argc - optind;
+    if(num_positional_args % 2 != 0){
+        cerr << "Error! Walk and result files must come in pairs but "
+             << num_positional_args << " files were given." << endl << endl;
+        cerr << usage << endl;
+        exit(1);
+    }
+    vector<ReplicateResult> pairs;
+    for(int i = optind; i < argc; i += 2){
+        pairs.push_back(ReplicateResult{argv[i], argv[i+1]});
+    }
+    if(fflag){
+        ifstream list_file(farg);
+        if(!list_file.is_open()){
+            cerr << "Error! Could not open the file \"" << farg << "\"" << endl;
+            cerr << "Check to make sure it exists and you have permisstions."
+                 << endl << endl;
+            cerr << usage << endl;
+            exit(1);
+        }
+        ReplicateResult pair;
+        while(list_file >> pair.walk_path >> pair.result_path){
+            pairs.push_back(pair);
+        }
+    }
+    if(pairs.empty()){
+        cerr << "Error! No walk and result files were given." << endl << endl;
+        cerr << usage << endl;
+        exit(1);
+    }
+
+    //Figure out what the separator character should be
+    char sep = ',';
+    if(sflag && sarg.length() == 1){
+        sep = sarg[0];
+    }
+
+    //Length of the original and the number of threads
+    size_t length = 0;
+    size_t threads = thread::hardware_concurrency();
+    try{
+        if(Lflag){
+            length = stoul(Larg);
+        }
+        if(jflag){
+            threads = stoul(jarg);
+        }
+    }
+    catch (std::invalid_argument& e){
+        cerr << "Error! The length and thread args must be non-negative integers."
+             << endl << endl;
+        cerr << usage << endl;
+        exit(1);
+    }
+    if(threads == 0){
+        threads = 1;
+    }
+    if(threads > pairs.size()){
+        threads = pairs.size();
+    }
+
+    //Translate everything in parallel
+    vector<SupportWorker> workers(threads);
+    vector<thread> pool;
+    atomic<size_t> next(0);
+    mutex error_mutex;
+    size_t failures = 0;
+    for(size_t i = 0; i < threads; i++){
+        pool.push_back(thread(SupportThread, std::cref(pairs), std::ref(next),
+                              sep, bflag, std::ref(workers[i]),
+                              std::ref(error_mutex), std::ref(failures)));
+    }
+    for(thread& worker : pool){
+        worker.join();
+    }
+    if(failures != 0){
+        cerr << failures << " of " << pairs.size()
+             << " replicates could not be translated." << endl;
+        exit(1);
+    }
+
+    //Merge the per thread histograms
+    if(!Lflag){
+        for(const SupportWorker& worker : workers){
+            length = max(length, worker.extent);
+        }
+    }
+    vector<size_t> support(length, 0);
+    for(const SupportWorker& worker : workers){
+        if(worker.histogram.size() > length){
+            cerr << "Error! Results reach site " << worker.histogram.size() - 1
+                 << " but the original is only " << length << " long." << endl;
+            exit(1);
+        }
+        for(size_t site = 0; site < worker.histogram.size(); site++){
+            support[site] += worker.histogram[site];
+        }
+    }
+
+    //And write out the support track
+    ostringstream output;
+    for(size_t site = 0; site < length; site++){
+        output << site << '\t' << support[site] << '\t'
+               << double(support[site]) / pairs.size() << '\n';
+    }
+    cout << output.str();
+}
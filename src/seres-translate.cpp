@@ -1,6 +1,7 @@
 #include "sequence.hpp"
 #include "walk.hpp"
 #include "resample.hpp"
+#include "translate.hpp"
 
 #include <getopt.h>
 
@@ -10,17 +11,20 @@ using std::istream;
 #include <fstream>
 using std::ifstream;
 #include <string>
-using std::string; using std::getline;
-#include <vector>
-using std::vector;
+using std::string;
+#include <stdexcept>
 
 string usage = 
 "USAGE:\n"
 "  seres-translate [OPTIONS] <walk file>\n\n"
 "FLAGS:\n"
 "  -h, --help              Display this message.\n"
-"  -p, --positon           Translate positions. (default)\n"
-"  -b, --breakpoint        Translate breakpoints.\n\n"
+"  -p, --position          Translate positions. (default)\n"
+"  -b, --breakpoint        Translate breakpoints.\n"
+"  -i, --interval          Translate intervals. Each input location is a range\n"
+"                          START:END of the replicate (0 based, end exclusive)\n"
+"                          and is written out on its own line as the original\n"
+"                          ranges it covers, as start:end:direction.\n\n"
 "OPTIONS:\n"
 "  -f, --file <file>       Accept input locations from a file rather than stdin.\n"
 "  -s, --sep <separator>   Separator for input locations, default is ','\n\n"
@@ -30,33 +34,18 @@ string usage =
 
 ;
 
-//Helper function which accepts an istream and a separator and parses the stream
-//to a vector of locations.
-vector<size_t> ReadStream(istream& stream, char separator){
-    vector<size_t> result;
-
-    string elem;
-    while(getline(stream, elem, separator)){
-       if(elem.length() == 0){
-           break; 
-       }
-       result.push_back(stoul(elem));
-    }
-
-    return result;
-}
-
 int main(int argc, char* argv[]){
 
     //Define the options for GNU getopt_long
     char c;
     extern char* optarg;
     extern int optind;
-    const char* const shortopts = "hpb";
+    const char* const shortopts = "hpbif:s:";
     const option longopts[] = {
         {"help", no_argument, nullptr, 'h'},
         {"position", no_argument, nullptr, 'p'},
         {"breakpoint", no_argument, nullptr, 'b'},
+        {"interval", no_argument, nullptr, 'i'},
         {"file", required_argument, nullptr, 'f'},
         {"sep", required_argument, nullptr, 's'},
         {nullptr, 0, nullptr, 0}
@@ -65,6 +54,7 @@ int main(int argc, char* argv[]){
     //Flags
     bool pflag = false;
     bool bflag = false;
+    bool iflag = false;
 
     //Options
     bool fflag = false;
@@ -81,6 +71,9 @@ int main(int argc, char* argv[]){
             case 'b':
                 bflag = true;
                 break;
+            case 'i':
+                iflag = true;
+                break;
             case 'f':
                 fflag = true;
                 farg.assign(optarg);
@@ -126,13 +119,13 @@ int main(int argc, char* argv[]){
     RandomWalk walk;
     input_walk_file >> walk;
 
-    //Next, make sure the b and p flag are set appropriatly
-    if(bflag && pflag){
-        cerr << "Error, the -b and -p flags are mutually exclusive." << endl; 
+    //Next, make sure the b, p and i flags are set appropriatly
+    if(int(bflag) + int(pflag) + int(iflag) > 1){
+        cerr << "Error, the -b, -p and -i flags are mutually exclusive." << endl; 
         cerr << endl << usage << endl;
         exit(1);
     }
-    if(!pflag && !bflag){
+    if(!pflag && !bflag && !iflag){
         pflag = true; 
     }
 
@@ -142,12 +135,10 @@ int main(int argc, char* argv[]){
         sep = sarg[0]; 
     }
 
-    //Fill this vector from whatever sounce we are given
-    vector<size_t> locations;
-
-    //Grab the locations from the input
+    //Open the file if we were given one, otherwise read stdin
+    ifstream ifs;
     if(fflag){
-        ifstream ifs(farg);
+        ifs.open(farg);
         if(!ifs.is_open()){
             cerr << "Error! Could not open the file \"" << farg << "\"" << endl;
             cerr << "Check to make sure it exists and you have permisstions."
@@ -155,23 +146,28 @@ int main(int argc, char* argv[]){
             cerr << usage << endl;
             exit(1);
         }
-        locations =  ReadStream(ifs, sep);
-    }
-    else{
-        locations =  ReadStream(cin, sep);
     }
+    istream& input = fflag ? ifs : cin;
 
-    //Translate all the locations
-    for(auto iter = locations.begin(); iter != locations.end(); iter++){
-        if(pflag){
-            cout << walk.lookup_position(*iter);
+    //Intervals are read and written differently, handle them separately
+    if(iflag){
+        try{
+            TranslateIntervals(walk, ReadIntervals(input, sep), cout);
         }
-        else{
-            cout << walk.lookup_breakpoint(*iter);
-        }
-        if(iter != locations.end() -1){
-            cout << ", ";
+        catch (std::exception& e){
+            cerr << "Error! " << e.what() << endl;
+            exit(1);
         }
+        return 0;
+    }
+
+    //Fill a vector from whatever sounce we are given and translate all the
+    //locations
+    try{
+        TranslateLocations(walk, ReadLocations(input, sep), bflag, cout);
+    }
+    catch (std::exception& e){
+        cerr << "Error! " << e.what() << endl;
+        exit(1);
     }
-    cout << endl;
 }
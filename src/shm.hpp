@@ -0,0 +1,168 @@
+/* Layout of the POSIX shared memory objects published by
+ * `seres-resample --shm <name>`, along with a small reader for consumer
+ * processes. This header is self contained, consumers only need to include it
+ * (and link with -lrt on older systems), none of the other seres sources.
+ *
+ * The object is a single contiguous region. Every section starts on a 64 byte
+ * boundary and every offset is measured in bytes from the start of the region.
+ *
+ *     ShmHeader                 fixed size, always at offset 0
+ *     taxa names                height null terminated strings, back to back
+ *     input matrix              height * length chars, row-major
+ *     walk index                replicate_count + 1 uint64_t, walk r is made of
+ *                               segments [index[r], index[r+1])
+ *     walk segments             ShmSegment records for every walk, in order
+ *     replicates (optional)     replicate_count matrices of height *
+ *                               replicate_length chars, each row-major
+ *
+ * All integers are in native byte order, the object is meant for processes on
+ * the same node. The magic is written last, so a reader which sees a valid
+ * magic sees a fully written object. Publishing again under the same name
+ * creates a new object rather than rewriting the old one, so a reader which
+ * already mapped it keeps a consistent view and opens the name again to see
+ * the new replicates.
+ */
+
+#pragma once
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <stdexcept>
+
+const char SHM_MAGIC[8] = {'S', 'E', 'R', 'E', 'S', 'S', 'H', 'M'};
+const uint32_t SHM_VERSION = 2;
+const uint32_t SHM_HAS_REPLICATES = 1;   //Flag bit, replicates are materialized
+
+struct ShmHeader{
+    char magic[8];
+    uint32_t version;
+    uint32_t flags;
+    uint64_t height;                //Rows in the input and in every replicate
+    uint64_t length;                //Columns in the input
+    uint64_t replicate_count;
+    uint64_t first_replicate;       //seres-resample's number for replicate 0
+    uint64_t replicate_length;      //Columns in every replicate
+    uint64_t taxa_offset;
+    uint64_t input_offset;
+    uint64_t walk_index_offset;
+    uint64_t segment_offset;
+    uint64_t replicate_offset;      //0 unless SHM_HAS_REPLICATES is set
+    uint64_t total_size;
+};
+
+//Same meaning as a WalkSegment, direction is 0 for right and 1 for left.
+struct ShmSegment{
+    uint64_t replicate_pos;
+    uint64_t original_pos;
+    uint64_t length;
+    uint64_t direction;
+};
+
+//Round an offset up to the next section boundary
+inline uint64_t ShmAlign(uint64_t offset){
+    return (offset + 63) & ~uint64_t(63);
+}
+
+//Read only view of a published object. Mapping is done once in the
+//constructor, every accessor afterwards is a plain pointer calculation.
+//Accessors are not bounds checked.
+class SharedReplicates{
+    private:
+        const char* base_ = nullptr;
+        size_t size_ = 0;
+        const ShmHeader* header_ = nullptr;
+
+        const uint64_t* walk_index() const{
+            return reinterpret_cast<const uint64_t*>(
+                base_ + header_->walk_index_offset);
+        }
+
+    public:
+
+        //Maps the object with the given name (as passed to --shm), throws
+        //std::runtime_error if it doesn't exist or isn't a valid object.
+        explicit SharedReplicates(const std::string& name){
+            std::string path = name[0] == '/' ? name : "/" + name;
+            int fd = shm_open(path.c_str(), O_RDONLY, 0);
+            if(fd < 0){
+                throw std::runtime_error("Could not open shared memory " + path);
+            }
+            struct stat info;
+            if(fstat(fd, &info) != 0 ||
+               size_t(info.st_size) < sizeof(ShmHeader)){
+                close(fd);
+                throw std::runtime_error("Shared memory " + path + " is too small");
+            }
+            size_ = info.st_size;
+            void* mapped = mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+            close(fd);
+            if(mapped == MAP_FAILED){
+                throw std::runtime_error("Could not map shared memory " + path);
+            }
+            base_ = static_cast<const char*>(mapped);
+            header_ = reinterpret_cast<const ShmHeader*>(base_);
+            if(std::memcmp(header_->magic, SHM_MAGIC, sizeof(SHM_MAGIC)) != 0 ||
+               header_->version != SHM_VERSION ||
+               header_->total_size != size_){
+                munmap(const_cast<char*>(base_), size_);
+                throw std::runtime_error("Shared memory " + path +
+                                         " is not a seres replicate set");
+            }
+        }
+
+        ~SharedReplicates(){
+            munmap(const_cast<char*>(base_), size_);
+        }
+        SharedReplicates(const SharedReplicates&) = delete;
+        SharedReplicates& operator=(const SharedReplicates&) = delete;
+
+        //Dimensions of the published data
+        size_t height() const{return header_->height;};
+        size_t length() const{return header_->length;};
+        size_t replicate_count() const{return header_->replicate_count;};
+        size_t first_replicate() const{return header_->first_replicate;};
+        size_t replicate_length() const{return header_->replicate_length;};
+        bool has_replicates() const{
+            return header_->flags & SHM_HAS_REPLICATES;
+        };
+
+        //Name of a row, null terminated. This walks the name table so it is
+        //linear in the row index, copy the names out if they're used a lot.
+        const char* taxon(size_t row_index) const{
+            const char* name = base_ + header_->taxa_offset;
+            for(size_t i = 0; i < row_index; i++){
+                name += std::strlen(name) + 1;
+            }
+            return name;
+        }
+
+        //A row of the input, length() chars long
+        const char* input_row(size_t row_index) const{
+            return base_ + header_->input_offset + row_index * header_->length;
+        }
+
+        //The segments of a walk, replicates are numbered from 0 here. Replicate
+        //r is the one seres-resample would number first_replicate() + r.
+        size_t walk_size(size_t replicate) const{
+            return walk_index()[replicate + 1] - walk_index()[replicate];
+        }
+        const ShmSegment* walk(size_t replicate) const{
+            return reinterpret_cast<const ShmSegment*>(
+                base_ + header_->segment_offset) + walk_index()[replicate];
+        }
+
+        //A row of a materialized replicate, replicate_length() chars long.
+        //Only valid if has_replicates() is true.
+        const char* replicate_row(size_t replicate, size_t row_index) const{
+            return base_ + header_->replicate_offset +
+                (replicate * header_->height + row_index) *
+                header_->replicate_length;
+        }
+};
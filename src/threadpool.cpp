@@ -0,0 +1,148 @@
+#include "threadpool.hpp"
+
+#include <cstddef>
+#include <functional>
+using std::function;
+#include <mutex>
+using std::mutex; using std::lock_guard; using std::unique_lock;
+#include <thread>
+using std::thread;
+#include <memory>
+using std::unique_ptr;
+#include <utility>
+using std::move;
+
+//Which pool and queue the current thread works for, if any. Lets submit()
+//push onto the caller's own deque when called from inside a task.
+static thread_local ThreadPool* current_pool = nullptr;
+static thread_local size_t current_index = 0;
+
+ThreadPool::ThreadPool(size_t threads): next_queue_(0){
+    if(threads == 0){
+        threads = 1;
+    }
+    for(size_t i = 0; i < threads; i++){
+        queues_.push_back(unique_ptr<WorkerQueue>(new WorkerQueue));
+    }
+    for(size_t i = 0; i < threads; i++){
+        workers_.push_back(thread(&ThreadPool::worker_loop, this, i));
+    }
+}
+
+//Finish whatever is queued and then let the workers exit
+ThreadPool::~ThreadPool(){
+    {
+        lock_guard<mutex> lock(state_mutex_);
+        stopping_ = true;
+    }
+    work_available_.notify_all();
+    for(thread& worker : workers_){
+        worker.join();
+    }
+}
+
+void ThreadPool::submit(function<void()> task){
+
+    //Workers push onto their own deque, everyone else spreads tasks around
+    size_t index;
+    if(current_pool == this){
+        index = current_index;
+    }
+    else{
+        index = next_queue_++ % queues_.size();
+    }
+
+    //Counting and queueing under one lock means queued_ never undercounts
+    //the tasks sitting in the deques.
+    {
+        lock_guard<mutex> lock(state_mutex_);
+        pending_++;
+        queued_++;
+        lock_guard<mutex> queue_lock(queues_[index]->mutex);
+        queues_[index]->tasks.push_back(move(task));
+    }
+    work_available_.notify_one();
+}
+
+//Take from the back of our own deque, otherwise steal from the front of
+//someone else's. Returns false if every deque was empty.
+bool ThreadPool::take_task(size_t index, function<void()>& task){
+    {
+        WorkerQueue& own = *queues_[index];
+        lock_guard<mutex> lock(own.mutex);
+        if(!own.tasks.empty()){
+            task = move(own.tasks.back());
+            own.tasks.pop_back();
+            return true;
+        }
+    }
+    for(size_t offset = 1; offset < queues_.size(); offset++){
+        WorkerQueue& victim = *queues_[(index + offset) % queues_.size()];
+        lock_guard<mutex> lock(victim.mutex);
+        if(!victim.tasks.empty()){
+            task = move(victim.tasks.front());
+            victim.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::worker_loop(size_t index){
+    current_pool = this;
+    current_index = index;
+
+    while(true){
+        {
+            unique_lock<mutex> lock(state_mutex_);
+            work_available_.wait(lock, [this]{
+                return stopping_ || queued_ > 0;
+            });
+            if(queued_ == 0){
+                return;
+            }
+        }
+
+        //Another worker may have beaten us to the task, just go around again
+        function<void()> task;
+        if(!take_task(index, task)){
+            std::this_thread::yield();
+            continue;
+        }
+        {
+            lock_guard<mutex> lock(state_mutex_);
+            queued_--;
+        }
+
+        try{
+            task();
+        }
+        catch(...){
+            lock_guard<mutex> lock(state_mutex_);
+            if(!error_){
+                error_ = std::current_exception();
+            }
+        }
+
+        lock_guard<mutex> lock(state_mutex_);
+        pending_--;
+        if(pending_ == 0){
+            all_done_.notify_all();
+        }
+    }
+}
+
+void ThreadPool::wait(){
+    unique_lock<mutex> lock(state_mutex_);
+    all_done_.wait(lock, [this]{return pending_ == 0;});
+    if(error_){
+        std::exception_ptr error = error_;
+        error_ = nullptr;
+        std::rethrow_exception(error);
+    }
+}
+
+size_t ThreadPool::default_threads(){
+    size_t threads = thread::hardware_concurrency();
+    return threads == 0 ? 1 : threads;
+}
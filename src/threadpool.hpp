@@ -0,0 +1,67 @@
+/* A fixed size pool of worker threads with work stealing. Every worker owns a
+ * deque of tasks. Tasks submitted from inside a worker go onto the back of its
+ * own deque and it keeps working from the back, so a task which fans out into
+ * subtasks tends to run them itself while they are still hot in cache. Idle
+ * workers steal from the front of other workers' deques, which hands out the
+ * oldest (and usually largest) pieces of work first.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <deque>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <exception>
+
+class ThreadPool{
+    private:
+
+        //Each worker's deque has its own lock so workers rarely contend
+        struct WorkerQueue{
+            std::mutex mutex;
+            std::deque<std::function<void()>> tasks;
+        };
+
+        std::vector<std::unique_ptr<WorkerQueue>> queues_;
+        std::vector<std::thread> workers_;
+
+        //Used to put idle workers to sleep and to wait for all tasks
+        std::mutex state_mutex_;
+        std::condition_variable work_available_;
+        std::condition_variable all_done_;
+        size_t pending_ = 0;        //Submitted but not yet finished
+        size_t queued_ = 0;         //Submitted but not yet started
+        bool stopping_ = false;
+        std::exception_ptr error_;
+        std::atomic<size_t> next_queue_;
+
+        void worker_loop(size_t index);
+        bool take_task(size_t index, std::function<void()>& task);
+
+    public:
+
+        //A pool of 0 threads is given one thread.
+        explicit ThreadPool(size_t threads);
+        ~ThreadPool();
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        //Queue a task. Safe to call from inside a running task.
+        void submit(std::function<void()> task);
+
+        //Block until every submitted task, including ones submitted by other
+        //tasks, has finished. If any task threw, the first exception is
+        //rethrown here.
+        void wait();
+
+        size_t size() const{return workers_.size();};
+
+        //Number of threads to use when the user doesn't say, at least 1
+        static size_t default_threads();
+};
@@ -0,0 +1,123 @@
+#include "translate.hpp"
+#include "walk.hpp"
+
+#include <cctype>
+#include <stdexcept>
+#include <istream>
+using std::istream;
+#include <ostream>
+using std::ostream;
+#include <string>
+using std::string; using std::getline; using std::to_string;
+#include <vector>
+using std::vector;
+#include <utility>
+using std::pair; using std::make_pair;
+#include <iterator>
+using std::istreambuf_iterator;
+
+vector<pair<size_t, size_t>> ReadIntervals(istream& stream, char separator){
+    string text((istreambuf_iterator<char>(stream)), istreambuf_iterator<char>());
+    vector<pair<size_t, size_t>> result;
+
+    size_t pos = 0;
+    auto skip_space = [&text, &pos]{
+        while(pos < text.size() && isspace(text[pos])) pos++;
+    };
+    auto read_number = [&text, &pos]{
+        if(pos >= text.size() || !isdigit(text[pos])){
+            throw std::invalid_argument("Expected a number at character " +
+                                        to_string(pos));
+        }
+        size_t value = 0;
+        while(pos < text.size() && isdigit(text[pos])){
+            value = value * 10 + (text[pos] - '0');
+            pos++;
+        }
+        return value;
+    };
+
+    while(true){
+        skip_space();
+        if(pos >= text.size()){
+            break;
+        }
+        size_t start = read_number();
+        skip_space();
+        if(pos >= text.size() || text[pos] != ':'){
+            throw std::invalid_argument("Expected ':' at character " +
+                                        to_string(pos));
+        }
+        pos++;
+        skip_space();
+        size_t end = read_number();
+        result.push_back(make_pair(start, end));
+        skip_space();
+        if(pos < text.size() && text[pos] == separator){
+            pos++;
+        }
+    }
+
+    return result;
+}
+
+void TranslateIntervals(const RandomWalk& walk, 
+                        const vector<pair<size_t, size_t>>& intervals,
+                        ostream& output){
+    vector<OriginalInterval> covered;
+    string buffer;
+    for(const auto& interval : intervals){
+        covered.clear();
+        walk.lookup_interval(interval.first, interval.second, covered);
+        for(size_t i = 0; i < covered.size(); i++){
+            if(i != 0){
+                buffer += ", ";
+            }
+            buffer += to_string(covered[i].start);
+            buffer += ':';
+            buffer += to_string(covered[i].end);
+            buffer += ':';
+            buffer += covered[i].direction == Direction::Left ? 'l' : 'r';
+        }
+        buffer += '\n';
+        if(buffer.size() > (1 << 20)){
+            output << buffer;
+            buffer.clear();
+        }
+    }
+    output << buffer;
+}
+
+vector<size_t> ReadLocations(istream& stream, char separator){
+    vector<size_t> result;
+
+    string elem;
+    while(getline(stream, elem, separator)){
+       if(elem.find_first_not_of(" \t\r\n") == string::npos){
+           continue;
+       }
+       result.push_back(stoul(elem));
+    }
+
+    return result;
+}
+
+void TranslateLocations(const RandomWalk& walk, const vector<size_t>& locations,
+                        bool breakpoints, ostream& output){
+    for(auto iter = locations.begin(); iter != locations.end(); iter++){
+        if(*iter > walk.length() || (!breakpoints && *iter == walk.length())){
+            throw std::out_of_range("Location " + to_string(*iter) +
+                                    " is past the end of the replicate");
+        }
+        if(breakpoints){
+            output << walk.lookup_breakpoint(*iter);
+        }
+        else{
+            output << walk.lookup_position(*iter);
+        }
+        if(iter != locations.end() -1){
+            output << ", ";
+        }
+    }
+    output << '\n';
+}
@@ -0,0 +1,39 @@
+/* Reading locations in a replicate and writing out where they came from in the
+ * original, shared by seres-translate and seres-daemon so both give exactly
+ * the same output.
+ */
+
+#pragma once
+
+#include "walk.hpp"
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+#include <istream>
+#include <ostream>
+
+//Reads positions or breakpoints separated by a separator char, skipping any
+//that are empty or only whitespace, such as after a trailing separator. Throws
+//std::invalid_argument if one isn't a number.
+std::vector<size_t> ReadLocations(std::istream&, char separator);
+
+//Parse a whole input of START:END intervals separated by a separator char.
+//Inputs can hold millions of intervals, so this parses a single buffer by hand
+//rather than going through a stream for every number. Throws
+//std::invalid_argument if the input is malformed.
+std::vector<std::pair<size_t, size_t>> ReadIntervals(std::istream&,
+                                                     char separator);
+
+//Translate positions (or breakpoints) and write them on one line separated by
+//", ". Throws std::out_of_range if one is past the end of the replicate.
+void TranslateLocations(const RandomWalk&, const std::vector<size_t>& locations,
+                        bool breakpoints, std::ostream&);
+
+//Translate every interval and write one line per interval, holding the
+//original ranges it covers as start:end:direction. Output goes through one
+//reused buffer which is flushed in large chunks. Throws std::out_of_range if
+//an interval isn't inside the replicate.
+void TranslateIntervals(const RandomWalk&,
+                        const std::vector<std::pair<size_t, size_t>>& intervals,
+                        std::ostream&);
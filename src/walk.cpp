@@ -1,4 +1,5 @@
 #include "walk.hpp"
+#include <cstdint>
 #include <istream>
 using std::istream;
 #include <ostream>
@@ -6,7 +7,14 @@ using std::ostream;
 #include <vector>
 using std::vector;
 #include <algorithm>
-using std::upper_bound;
+using std::upper_bound; using std::min; using std::max;
+#include <stdexcept>
+#include <string>
+using std::string; using std::to_string;
+#include <fstream>
+using std::ifstream;
+#include <sstream>
+using std::istringstream; using std::ostringstream;
 
 #include <iostream>
 using std::cerr;
@@ -67,23 +75,78 @@ ostream& operator<<(ostream& stream, const WalkSegment& segment){
     return stream;
 }
 
+ostream& operator<<(ostream& stream, const OriginalInterval& interval){
+    stream << interval.start << ':' << interval.end << ':' << interval.direction;
+    return stream;
+}
+
 //Constructor
 RandomWalk::RandomWalk(vector<WalkSegment> invec): RandomWalk(){
 
 }
 
+void RandomWalk::push_back(const WalkSegment& ws){
+    if(!wide_ && (ws.original_pos > UINT32_MAX ||
+                  ws.replicate_pos + ws.length > UINT32_MAX)){
+        widen();
+    }
+    if(wide_){
+        sequence_.push_back(ws);
+    }
+    else{
+        replicate_starts_.push_back(ws.replicate_pos);
+        original_starts_.push_back(ws.original_pos);
+        left_.push_back(ws.direction == Direction::Left);
+    }
+    length_ = ws.replicate_pos + ws.length;
+}
+
+void RandomWalk::widen(){
+    sequence_.reserve(size());
+    for(size_t index = 0; index < size(); index++){
+        sequence_.push_back(segment(index));
+    }
+    wide_ = true;
+    replicate_starts_ = vector<uint32_t>();
+    original_starts_ = vector<uint32_t>();
+    left_ = vector<bool>();
+}
+
+size_t RandomWalk::size() const{
+    return wide_ ? sequence_.size() : replicate_starts_.size();
+}
+
+WalkSegment RandomWalk::segment(size_t index) const{
+    if(wide_){
+        return sequence_[index];
+    }
+    size_t end = index + 1 < replicate_starts_.size() ? 
+                 replicate_starts_[index + 1] : length_;
+    return WalkSegment(replicate_starts_[index], original_starts_[index],
+                       end - replicate_starts_[index],
+                       left_[index] ? Direction::Left : Direction::Right);
+}
+
+size_t RandomWalk::memory_usage() const{
+    if(wide_){
+        return sequence_.size() * sizeof(WalkSegment);
+    }
+    return replicate_starts_.size() * 2 * sizeof(uint32_t) +
+           (left_.size() + 7) / 8;
+}
+
 bool RandomWalk::add(WalkSegment current){
 
 
     //The trivial case is easy, if the sequence is empty, anything is valid
-    if(sequence_.empty()){
-        sequence_.push_back(current); 
+    if(size() == 0){
+        push_back(current); 
         return true;
     }
 
     //We can determine if the new ws is allowed by comparing it to the back of
     //the current sequence and seeing if it meets our chriteria.
-    const WalkSegment& last = sequence_.back();
+    const WalkSegment last = segment(size() - 1);
 
     //Replicate position must be exactly one greater
     if(current.replicate_pos != last.replicate_pos + last.length){
@@ -110,7 +173,7 @@ bool RandomWalk::add(WalkSegment current){
         }
     }
 
-    sequence_.push_back(current);
+    push_back(current);
     return true;
 }
 
@@ -120,84 +183,194 @@ bool RandomWalk::add(size_t original_pos, size_t run_length, Direction direction
 }
 
 size_t RandomWalk::length() const{
-    if(sequence_.empty()){
-        return 0; 
+    return length_;
+}
+
+bool RandomWalk::start_partition(WalkSegment current){
+    if(size() == 0){
+        push_back(current);
+        return true;
     }
+    if(current.replicate_pos != length()){
+        return false;
+    }
+    partition_starts_.push_back(size());
+    push_back(current);
+    return true;
+}
 
-    return sequence_.back().replicate_pos + sequence_.back().length;
+void RandomWalk::append_partition(const RandomWalk& other, 
+                                  size_t original_offset){
+    size_t replicate_offset = length();
+    bool first = true;
+    for(WalkSegment ws : other){
+        ws.replicate_pos += replicate_offset;
+        ws.original_pos += original_offset;
+        if(first){
+            start_partition(ws);
+            first = false;
+        }
+        else{
+            push_back(ws);
+        }
+    }
+}
+
+//Find the segment with the largest replicate position not larger than the
+//querry, use binary search for this. In the compact representation this only
+//has to look at the replicate starts.
+size_t RandomWalk::find_segment(size_t pos) const{
+    if(wide_){
+        auto iter = upper_bound(sequence_.begin(), sequence_.end(), pos,
+                    [](size_t pos, const WalkSegment& ws){return ws.replicate_pos > pos;});
+        return iter - sequence_.begin() - 1;
+    }
+    if(pos > UINT32_MAX){
+        return replicate_starts_.size() - 1;
+    }
+    auto iter = upper_bound(replicate_starts_.begin(), replicate_starts_.end(),
+                            uint32_t(pos));
+    return iter - replicate_starts_.begin() - 1;
 }
 
 //Functions used to lookup positions or breakpoints, will throw if
 //positions can't be looked up.
 size_t RandomWalk::lookup_position(size_t pos) const{
 
-    //Find the segment with the largest replicate position not larger than the
-    //querry, use binary search for this.
-    auto iter = upper_bound(sequence_.begin(), sequence_.end(), pos,
-                [](size_t pos, WalkSegment ws){return ws.replicate_pos > pos;});
-    iter--;
-
+    //Find the segment holding the position
+    const WalkSegment ws = segment(find_segment(pos));
 
     //Figure out how much we are off by
-    size_t diff = pos - iter->replicate_pos;
+    size_t diff = pos - ws.replicate_pos;
 
     //And use that to calculate the final position
-    if(iter->direction == Direction::Right){
-        return iter -> original_pos + diff;    
+    if(ws.direction == Direction::Right){
+        return ws.original_pos + diff;    
     }
     else{
-        return iter -> original_pos - diff;    
+        return ws.original_pos - diff;    
     }
 }
 size_t RandomWalk::lookup_breakpoint(size_t bkpt) const{
 
-    //Find the segment with the largest replicate position not larger than the
-    //querry, use binary search for this.
-    auto iter = upper_bound(sequence_.begin(), sequence_.end(), bkpt,
-                [](size_t pos, WalkSegment ws){return ws.replicate_pos > pos;});
-    iter--;
-
+    //Find the segment holding the breakpoint
+    const WalkSegment ws = segment(find_segment(bkpt));
 
     //Figure out how much we are off by
-    size_t diff = bkpt - iter->replicate_pos;
+    size_t diff = bkpt - ws.replicate_pos;
 
     //And use that to calculate the final position
-    if(iter->direction == Direction::Right){
-        return iter -> original_pos + diff;    
+    if(ws.direction == Direction::Right){
+        return ws.original_pos + diff;    
     }
     else{
-        return iter -> original_pos - diff + 1;    
+        return ws.original_pos - diff + 1;    
     }
 
 }
 
+vector<OriginalInterval> RandomWalk::lookup_interval(size_t start, 
+                                                    size_t end) const{
+    vector<OriginalInterval> result;
+    lookup_interval(start, end, result);
+    return result;
+}
+
+void RandomWalk::lookup_interval(size_t start, size_t end,
+                                 vector<OriginalInterval>& result) const{
+    if(start > end || end > length()){
+        throw std::out_of_range("Interval " + to_string(start) + ":" + 
+                                to_string(end) + " is not inside the replicate");
+    }
+    if(start == end){
+        return;
+    }
+
+    //Find the segment holding the start of the interval, as for positions,
+    //then clip each segment the interval overlaps to the interval
+    for(size_t index = find_segment(start); index < size(); index++){
+        const WalkSegment ws = segment(index);
+        if(ws.replicate_pos >= end){
+            break;
+        }
+        size_t first = max(start, ws.replicate_pos) - ws.replicate_pos;
+        size_t last = min(end, ws.replicate_pos + ws.length) - ws.replicate_pos;
+        if(ws.direction == Direction::Right){
+            result.push_back(OriginalInterval(ws.original_pos + first,
+                                              ws.original_pos + last,
+                                              Direction::Right));
+        }
+        else{
+            result.push_back(OriginalInterval(ws.original_pos - last + 1,
+                                              ws.original_pos - first + 1,
+                                              Direction::Left));
+        }
+    }
+}
+
 //Functions which allow access to the internal sequence, these do not
 //allow modification as this could break internal state.
-vector<WalkSegment>::const_iterator RandomWalk::begin() const{
-    return sequence_.cbegin();
+RandomWalk::const_iterator RandomWalk::begin() const{
+    return const_iterator(this, 0);
 }
-vector<WalkSegment>::const_iterator RandomWalk::end() const{
-    return sequence_.cend();
+RandomWalk::const_iterator RandomWalk::end() const{
+    return const_iterator(this, size());
 }
 
 //Stream overloads for the walk object
 istream& operator>>(istream& stream, RandomWalk& walk){
     WalkSegment ws;
+    bool new_partition = false;
     while(stream >> ws){
-        walk.add(ws);
+        if(new_partition){
+            walk.start_partition(ws);
+        }
+        else{
+            walk.add(ws);
+        }
         char c;
         stream >> c;
+        new_partition = c == '|';
     }
     return stream;
 }
 
 ostream& operator<<(ostream& stream, const RandomWalk& walk){
-    for (auto iter = walk.begin(); iter != walk.end(); iter++){
-        stream << *iter;
-        if(iter != walk.end() - 1){
+    const vector<size_t>& partition_starts = walk.partition_starts();
+    auto next_partition = partition_starts.begin();
+    size_t index = 0;
+    for (auto iter = walk.begin(); iter != walk.end(); iter++, index++){
+        if(next_partition != partition_starts.end() && *next_partition == index){
+            stream << " | ";
+            next_partition++;
+        }
+        else if(index != 0){
             stream << ", ";
         }
+        stream << *iter;
     }
     stream << ';';
     return stream;
 }
+
+RandomWalk ReadWalkFile(const string& path){
+    ifstream file(path);
+    if(!file.is_open()){
+        throw std::runtime_error("could not open \"" + path + "\"");
+    }
+    ostringstream contents;
+    contents << file.rdbuf();
+    string text = contents.str();
+
+    //Reading stops at the first thing which isn't a segment, which must be
+    //the end of the file, and the last thing before it must be the ';'
+    size_t last = text.find_last_not_of(" \t\r\n");
+    istringstream stream(text);
+    RandomWalk walk;
+    stream >> walk;
+    if(last == string::npos || text[last] != ';' || !stream.eof() ||
+       walk.size() == 0){
+        throw std::runtime_error("\"" + path + "\" is not a complete walk file");
+    }
+    return walk;
+}
\ No newline at end of file
@@ -4,11 +4,24 @@
  * Each random walk is composed of a sequence of WalkSegments, each encoding a
  * contiguous run where the resampler is moving left or right over columns of 
  * the original alignment and appending them to thre replicate.
+ *
+ * Walks can have millions of segments, so RandomWalk doesn't store them as
+ * WalkSegments unless it has to. While every position fits in 32 bits it keeps
+ * a structure of arrays instead: the replicate start and original start of
+ * each segment as uint32_t, and the direction as a single bit. Lengths aren't
+ * stored at all since they follow from the next segment's replicate start.
+ * That is about 8 bytes a segment rather than 32, and the binary search behind
+ * every lookup only touches the array of replicate starts. A walk switches to
+ * plain WalkSegments by itself as soon as a position no longer fits.
  */
 
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
 #include <vector>
+#include <string>
 #include <istream>
 #include <ostream>
 
@@ -49,6 +62,21 @@ struct WalkSegment{
 std::istream& operator>>(std::istream&, WalkSegment&);
 std::ostream& operator<<(std::ostream&, const WalkSegment&);
 
+//A run of original columns [start, end) which part of a replicate was copied
+//from. For a left interval the replicate visits them from end - 1 down to start.
+struct OriginalInterval{
+    size_t start;
+    size_t end;
+    Direction direction;
+
+    OriginalInterval() = default;
+    OriginalInterval(size_t s, size_t e, Direction d):
+        start(s), end(e), direction(d){};
+};
+
+//Written like a walk segment, "start:end:d", e.g. "8:18:r"
+std::ostream& operator<<(std::ostream&, const OriginalInterval&);
+
 //This composite type is a whole sequence of adjacent WalkSegments which
 //represents an entire run of the resampler. This object compleetly defines a
 //whole resampling operation and thus can be used to create concrete replicate
@@ -56,11 +84,75 @@ std::ostream& operator<<(std::ostream&, const WalkSegment&);
 //originals.
 class RandomWalk{
 
-    //Internally it is just a sequence, extra logic ensures that it is valid
+    //Internally it is just a sequence, extra logic ensures that it is valid.
+    //Walks over partitioned alignments also remember which segments start a
+    //new partition, since those are allowed to jump in the original.
     private:
+        //The compact representation, one entry per segment
+        std::vector<uint32_t> replicate_starts_;
+        std::vector<uint32_t> original_starts_;
+        std::vector<bool> left_;
+
+        //The wide representation, only used once wide_ is set
+        bool wide_ = false;
         std::vector<WalkSegment> sequence_;
 
+        size_t length_ = 0;
+        std::vector<size_t> partition_starts_;
+
+        //Append a segment without any checks, widening first if need be
+        void push_back(const WalkSegment&);
+
+        //Move every segment over to the wide representation
+        void widen();
+
+        //Index of the segment holding a replicate position
+        size_t find_segment(size_t replicate_pos) const;
+
     public:
+
+        //Iterates over the segments in order. Segments are put together on
+        //the fly, so dereferencing gives a WalkSegment by value.
+        class const_iterator{
+            private:
+                const RandomWalk* walk_ = nullptr;
+                size_t index_ = 0;
+
+            public:
+                typedef std::input_iterator_tag iterator_category;
+                typedef WalkSegment value_type;
+                typedef std::ptrdiff_t difference_type;
+                typedef const WalkSegment* pointer;
+                typedef WalkSegment reference;
+
+                //Holds a segment so that iter->length works
+                struct arrow{
+                    WalkSegment segment;
+                    const WalkSegment* operator->() const{return &segment;};
+                };
+
+                const_iterator() = default;
+                const_iterator(const RandomWalk* walk, size_t index):
+                    walk_(walk), index_(index){};
+
+                WalkSegment operator*() const{return walk_->segment(index_);};
+                arrow operator->() const{return arrow{walk_->segment(index_)};};
+                const_iterator& operator++(){index_++; return *this;};
+                const_iterator operator++(int){
+                    const_iterator previous = *this;
+                    index_++;
+                    return previous;
+                };
+                difference_type operator-(const const_iterator& other) const{
+                    return difference_type(index_) - difference_type(other.index_);
+                };
+                bool operator==(const const_iterator& other) const{
+                    return index_ == other.index_ && walk_ == other.walk_;
+                };
+                bool operator!=(const const_iterator& other) const{
+                    return !(*this == other);
+                };
+        };
         
         //Empty construction is always allowed, as is construction from a
         //sequence.
@@ -73,19 +165,60 @@ class RandomWalk{
         //Add a new walk segment while infering the replicate position
         bool add(size_t original_pos, size_t lenght, Direction direction);
 
+        //Add a segment which starts a new partition. It must continue the
+        //replicate, but may start anywhere in the original and move either
+        //way. Returns false if the replicate position doesn't follow on.
+        bool start_partition(WalkSegment);
+
+        //Append a whole walk as a new partition, shifting its original
+        //positions by original_offset. Used to concatenate per-partition walks.
+        void append_partition(const RandomWalk&, size_t original_offset);
+
+        //Indices of the segments which start a partition, not including the
+        //first segment. Empty for an ordinary walk.
+        const std::vector<size_t>& partition_starts() const{
+            return partition_starts_;
+        };
+
         //Functions used to lookup positions or breakpoints, will throw if
         //positions can't be looked up.
         size_t lookup_position(size_t) const;
         size_t lookup_breakpoint(size_t) const;
 
+        //Translate the replicate interval [start, end) into the original
+        //intervals it covers, in replicate order. Takes time proportional to
+        //the number of segments the interval overlaps (after a binary search
+        //for the first one). The second version appends to a vector so it
+        //can be reused across many lookups. Throws std::out_of_range if the
+        //interval isn't inside the replicate.
+        std::vector<OriginalInterval> lookup_interval(size_t start, 
+                                                      size_t end) const;
+        void lookup_interval(size_t start, size_t end, 
+                             std::vector<OriginalInterval>& result) const;
+
         size_t length() const;
 
+        //Number of segments, and a single segment by index
+        size_t size() const;
+        WalkSegment segment(size_t index) const;
+
+        //True while the walk is held in the compact representation, and the
+        //approximate number of bytes its segments take up.
+        bool compact() const{return !wide_;};
+        size_t memory_usage() const;
+
         //Functions which allow access to the internal sequence, these do not
         //allow modification as this could break internal state.
-        std::vector<WalkSegment>::const_iterator begin() const;
-        std::vector<WalkSegment>::const_iterator end() const;
+        const_iterator begin() const;
+        const_iterator end() const;
 };
 
-//Overloads for reading and writing random walks
+//Overloads for reading and writing random walks. Segments are separated by
+//", ", except where a new partition starts which is marked with " | ".
 std::istream& operator>>(std::istream&, RandomWalk&);
 std::ostream& operator<<(std::ostream&, const RandomWalk&);
+
+//Reads a whole walk file as written by seres-resample. Throws
+//std::runtime_error if the file can't be opened, holds no segments, or doesn't
+//parse all the way to the closing ';', as a truncated file wouldn't.
+RandomWalk ReadWalkFile(const std::string& path);